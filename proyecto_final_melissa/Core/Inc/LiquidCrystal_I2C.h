@@ -2,6 +2,7 @@
 #define LIQUIDCRYSTAL_I2C_H
 
 #include "stm32f4xx_hal.h"
+#include <stdbool.h>
 
 // Define commands
 #define LCD_CLEARDISPLAY 0x01
@@ -41,6 +42,9 @@
 #define LCD_5x10DOTS 0x04
 #define LCD_5x8DOTS 0x00
 
+// Status read (RS=0, RW=1)
+#define LCD_BUSYFLAG 0x80
+
 // Flags for backlight control
 #define LCD_BACKLIGHT 0x08
 #define LCD_NOBACKLIGHT 0x00
@@ -51,6 +55,68 @@
 #define Rw 0x02  // Read/Write bit (P1)
 #define Rs 0x01  // Register select bit (P0)
 
+// Shadow framebuffer geometry (largest supported panel is 20x4)
+#define LCD_MAX_COLS 20
+#define LCD_MAX_ROWS 4
+#define LCD_FB_SIZE (LCD_MAX_COLS * LCD_MAX_ROWS)
+#define LCD_ADDR_UNKNOWN 0xFF  // Address counter not tracked (CGRAM access, RTL mode...)
+
+// Expander byte stream: every nibble is sent as E-high/E-low pairs packed into
+// one I2C write. 128 bytes hold a full 20-char line plus its address command.
+#define LCD_TXBUF_SIZE 128
+#define LCD_MODE_UNKNOWN 0xFF  // RS/RW state of the expander not known yet
+
+// Transmit ring drained by I2C TX DMA, used when the I2C handle has a DMA
+// stream linked (hdmatx). Must be a power of two; 512 bytes hold a full
+// 20x4 redraw while the previous one is still on the bus.
+#define LCD_RING_SIZE 512
+
+// Busy-flag polling: probed at begin(), falls back to fixed datasheet delays
+// when RW is not wired on the backpack. A status read costs ~0.5ms of bus
+// time, so only waits this long or longer are polled. With DMA the ring
+// stops after the slow instruction and the I2C interrupts poll BF before the
+// next chunk starts; up to LCD_BF_WAITS such waits can be queued at once
+// (more fall back to padding).
+#define LCD_USE_BUSY_FLAG 1
+#define LCD_BF_MIN_WAIT_US 1000
+#define LCD_BF_WAITS 4
+
+// CGRAM glyph cache: 8 custom character slots, least recently used is evicted
+#define LCD_GLYPH_SLOTS 8
+
+// Pre-encoded static screens: the macros below expand four string literals
+// into the exact PCF8574 byte stream at build time (stored in flash), so a
+// screen is sent in one burst with no per-character work. The stream assumes
+// a 20x4 panel with the backlight on; anything else falls back to the
+// framebuffer path.
+#define LCD_ENC_PAD "                    "
+#define LCD_ENC_NIBBLE(n, mode) \
+    (uint8_t)(((n) & 0xF0) | (mode) | LCD_BACKLIGHT | En), \
+    (uint8_t)(((n) & 0xF0) | (mode) | LCD_BACKLIGHT)
+#define LCD_ENC_BYTE(v, mode) LCD_ENC_NIBBLE(v, mode), LCD_ENC_NIBBLE((v) << 4, mode)
+#define LCD_ENC_SETUP(mode) (uint8_t)((mode) | LCD_BACKLIGHT)
+#define LCD_ENC_CHAR(s, i) LCD_ENC_BYTE((uint8_t)((s LCD_ENC_PAD)[i]), Rs)
+#define LCD_ENC_ROW(s) \
+    LCD_ENC_CHAR(s, 0), LCD_ENC_CHAR(s, 1), LCD_ENC_CHAR(s, 2), LCD_ENC_CHAR(s, 3), LCD_ENC_CHAR(s, 4), \
+    LCD_ENC_CHAR(s, 5), LCD_ENC_CHAR(s, 6), LCD_ENC_CHAR(s, 7), LCD_ENC_CHAR(s, 8), LCD_ENC_CHAR(s, 9), \
+    LCD_ENC_CHAR(s, 10), LCD_ENC_CHAR(s, 11), LCD_ENC_CHAR(s, 12), LCD_ENC_CHAR(s, 13), LCD_ENC_CHAR(s, 14), \
+    LCD_ENC_CHAR(s, 15), LCD_ENC_CHAR(s, 16), LCD_ENC_CHAR(s, 17), LCD_ENC_CHAR(s, 18), LCD_ENC_CHAR(s, 19)
+
+// Rows 0+2 and 1+3 are contiguous in DDRAM: two address moves per screen
+#define LCD_SCREEN(name, r0, r1, r2, r3) \
+    static const uint8_t name##_stream[] = { \
+        LCD_ENC_SETUP(0), LCD_ENC_BYTE(LCD_SETDDRAMADDR | 0x00, 0), \
+        LCD_ENC_SETUP(Rs), LCD_ENC_ROW(r0), LCD_ENC_ROW(r2), \
+        LCD_ENC_SETUP(0), LCD_ENC_BYTE(LCD_SETDDRAMADDR | 0x40, 0), \
+        LCD_ENC_SETUP(Rs), LCD_ENC_ROW(r1), LCD_ENC_ROW(r3)}; \
+    static const LCD_Screen_t name = {{r0, r1, r2, r3}, name##_stream, sizeof(name##_stream)}
+
+typedef struct {
+    const char *rows[LCD_MAX_ROWS];
+    const uint8_t *stream;
+    uint16_t len;
+} LCD_Screen_t;
+
 // Struct to hold LCD information
 typedef struct {
     I2C_HandleTypeDef *hi2c;
@@ -62,6 +128,51 @@ typedef struct {
     uint8_t _cols;
     uint8_t _rows;
     uint8_t _backlightval;
+
+    // Shadow framebuffer: _frame holds what the caller wants on screen,
+    // _shadow holds what the controller DDRAM already shows. Both are indexed
+    // row * LCD_MAX_COLS + col. LiquidCrystal_I2C_commit() sends the difference.
+    uint8_t _frame[LCD_FB_SIZE];
+    uint8_t _shadow[LCD_FB_SIZE];
+    uint8_t _fbCol;
+    uint8_t _fbRow;
+    uint8_t _ddramAddr;  // Controller address counter as far as we know
+
+    // Pending PCF8574 bytes, sent as a single I2C transaction on flush
+    uint8_t _txBuf[LCD_TXBUF_SIZE];
+    uint16_t _txLen;
+    uint8_t _txMode;  // RS/RW bits currently latched on the expander
+
+    // Async transmit ring: flush() appends, the DMA completion drains it.
+    // _dmaLen is the chunk currently in flight (0 = DMA idle).
+    uint8_t _ring[LCD_RING_SIZE];
+    volatile uint16_t _ringHead;
+    volatile uint16_t _ringTail;
+    volatile uint16_t _dmaLen;
+    volatile bool _txError;  // A chunk was dropped, shadow must be redrawn
+
+    volatile bool _busyFlag;  // Backpack can read BF/address counter back
+
+    // Queued BF waits (async): ring index where the DMA has to stop, datasheet
+    // wait and RS bits to restore after the read. _bfStep is the transfer of
+    // the status read in flight (0 = none).
+    struct {
+        uint16_t pos;
+        uint16_t us;
+        uint8_t mode;
+    } _bfWait[LCD_BF_WAITS];
+    volatile uint8_t _bfHead;
+    volatile uint8_t _bfTail;
+    volatile uint8_t _bfStep;
+    bool _bfError;  // A transfer of the status read in flight failed
+    uint8_t _bfIo[4];      // E strobe, then E low and RW back low
+    uint8_t _bfNibble[2];  // Status read back, high nibble first
+    uint32_t _bfDeadline;
+
+    uint8_t _glyphMap[LCD_GLYPH_SLOTS][8];  // Bitmap resident in each slot
+    uint32_t _glyphHash[LCD_GLYPH_SLOTS];
+    uint32_t _glyphStamp[LCD_GLYPH_SLOTS];  // Last use, 0 = slot free
+    uint32_t _glyphClock;
 } LiquidCrystal_I2C_t;
 
 // Function prototypes
@@ -90,4 +201,24 @@ void LiquidCrystal_I2C_write(LiquidCrystal_I2C_t *lcd, uint8_t value);
 void LiquidCrystal_I2C_command(LiquidCrystal_I2C_t *lcd, uint8_t value);
 void LiquidCrystal_I2C_print(LiquidCrystal_I2C_t *lcd, const char *str);
 
+// Framebuffer API: draw into RAM, then commit only the changed cells
+void LiquidCrystal_I2C_fbClear(LiquidCrystal_I2C_t *lcd);
+void LiquidCrystal_I2C_fbSetCursor(LiquidCrystal_I2C_t *lcd, uint8_t col, uint8_t row);
+void LiquidCrystal_I2C_fbWrite(LiquidCrystal_I2C_t *lcd, uint8_t value);
+void LiquidCrystal_I2C_fbPrint(LiquidCrystal_I2C_t *lcd, const char *str);
+void LiquidCrystal_I2C_commit(LiquidCrystal_I2C_t *lcd);
+
+// Static screens (see LCD_SCREEN): replaces the frame and the display
+// contents, the framebuffer cursor is left at (0, 0)
+void LiquidCrystal_I2C_showScreen(LiquidCrystal_I2C_t *lcd, const LCD_Screen_t *screen);
+
+// Glyph cache: returns the character code (0-7) holding 'charmap', uploading
+// it to CGRAM only if it is not resident yet
+uint8_t LiquidCrystal_I2C_glyph(LiquidCrystal_I2C_t *lcd, const uint8_t charmap[8]);
+
+// DMA completion hooks
+void LiquidCrystal_I2C_TxCpltCallback(LiquidCrystal_I2C_t *lcd); // Call in HAL_I2C_MasterTxCpltCallback
+void LiquidCrystal_I2C_RxCpltCallback(LiquidCrystal_I2C_t *lcd); // Call in HAL_I2C_MasterRxCpltCallback
+void LiquidCrystal_I2C_ErrorCallback(LiquidCrystal_I2C_t *lcd);  // Call in HAL_I2C_ErrorCallback
+
 #endif
@@ -0,0 +1,55 @@
+#ifndef FSM_H
+#define FSM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Table-driven state machine engine. The transitions live in const tables
+// (flash), normally generated by fsm_gen.py: a byte per [state][event] cell
+// indexes a packed array of {guard, action, next} entries. The entries of a
+// cell are tried in order until one has no guard or its guard passes, so
+// each list ends with an unguarded entry. FSM_NO_CELL ignores the event.
+//
+// A transition runs exit(old), action, entry(new), then dispatches
+// FSM_EV_COMPLETION in the new state, so transient states (decisions) move
+// on without an external event. The chain is a loop bounded by
+// FSM_MAX_CHAIN, never recursion. Actions must not call Fsm_Dispatch.
+
+#define FSM_EV_COMPLETION 0      // Event 0 is reserved
+#define FSM_NO_TRANSITION 0xFF   // Internal transition: action only
+#define FSM_NO_CELL 0xFF         // Event not handled in this state
+#define FSM_MAX_CHAIN 4          // Completion hops after one event
+
+typedef bool (*Fsm_Guard_t)(uint32_t arg);
+typedef void (*Fsm_Action_t)(uint32_t arg);
+
+typedef struct {
+  Fsm_Guard_t guard;   // NULL: always taken
+  Fsm_Action_t action; // NULL: none
+  uint8_t next;        // Target state or FSM_NO_TRANSITION
+} Fsm_Transition_t;
+
+typedef struct {
+  Fsm_Action_t entry; // NULL: none
+  Fsm_Action_t exit;
+} Fsm_StateDef_t;
+
+typedef struct {
+  const Fsm_StateDef_t *states;
+  const uint8_t *cells; // [state * eventCount + event]
+  const Fsm_Transition_t *transitions;
+  uint8_t eventCount;
+  uint8_t state;
+} Fsm_t;
+
+// Start in 'initial' (its entry action is not run)
+void Fsm_Init(Fsm_t *fsm, const Fsm_StateDef_t *states, const uint8_t *cells,
+              const Fsm_Transition_t *transitions, uint8_t eventCount,
+              uint8_t initial);
+// 'arg' is passed to the guards and actions of the whole chain
+void Fsm_Dispatch(Fsm_t *fsm, uint8_t event, uint32_t arg);
+
+static inline uint8_t Fsm_State(const Fsm_t *fsm) { return fsm->state; }
+
+#endif
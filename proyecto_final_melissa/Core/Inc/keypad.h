@@ -1,32 +1,66 @@
 #ifndef KEYPAD_H
 #define KEYPAD_H
 
+#include "ring.h"
 #include "stm32f4xx_hal.h"
 #include <stdbool.h>
 
 // Define Keypad Dimensions
 #define KEYPAD_ROWS 4
 #define KEYPAD_COLS 4
+#define KEYPAD_QUEUE_LEN 16 // Events waiting for the main loop (power of 2)
+// Row samples kept by the DMA, one per timer period (1 ms): 32 ms of history.
+// Multiple of KEYPAD_COLS, so sample i always belongs to column
+// i % KEYPAD_COLS.
+#define KEYPAD_SAMPLES 32
+// Keypad_Scan period: one full matrix. Must stay well under KEYPAD_SAMPLES ms
+// or unread samples get overwritten (a longer gap, such as the one before the
+// first call, drops the stale history).
+#define KEYPAD_SCAN_MS 4
+// Consecutive samples of a key (one every KEYPAD_COLS ms) that make a press
+// or a release: 3 x 4 ms, so a key is reported 12-16 ms after its contact
+// settles, plus up to KEYPAD_SCAN_MS until Keypad_Scan runs.
+#define KEYPAD_DEBOUNCE_SAMPLES 3
+
+// Press/release event, timestamped with HAL_GetTick
+typedef struct {
+    char key;
+    bool pressed; // false: released
+    uint32_t time;
+} Keypad_Event_t;
+
+// Events from Keypad_Scan to their reader
+RING_DEFINE(Keypad_Ring, Keypad_Event_t, KEYPAD_QUEUE_LEN)
 
 // Keypad Structure
+// The matrix is scanned by DMA with no CPU involvement: on every timer update
+// one stream writes the next column pattern to the columns' BSRR, and on every
+// CC1 match (late in the period, once the column has settled) another stream
+// copies the rows' IDR into 'samples'. Rows must share one port, and so must
+// columns.
 typedef struct {
     GPIO_TypeDef* RowPorts[KEYPAD_ROWS];
     uint16_t RowPins[KEYPAD_ROWS];
     GPIO_TypeDef* ColPorts[KEYPAD_COLS];
     uint16_t ColPins[KEYPAD_COLS];
-    TIM_HandleTypeDef* Timer; // Timer for scanning
+    TIM_HandleTypeDef* Timer; // Update and CC1 DMA requests linked (TIM1)
     
     // Internal State
-    uint8_t currentColumn;
-    volatile char lastKey;
-    volatile bool newKeyAvailable;
-    uint32_t lastDebounceTime;
+    uint32_t columnTable[KEYPAD_COLS]; // BSRR words, entry i selects column i + 1
+    volatile uint16_t samples[KEYPAD_SAMPLES]; // IDR copies, circular (DMA)
+    uint16_t readIndex; // Next sample for Keypad_Scan
+    uint32_t lastScan; // HAL_GetTick of the last Keypad_Scan (or Keypad_Init)
+    uint16_t busy; // Keys with a non-zero integrator, same bits as 'pressed'
+    uint8_t integrator[KEYPAD_ROWS][KEYPAD_COLS]; // 0..KEYPAD_DEBOUNCE_SAMPLES
+    uint16_t pressed; // Debounced state, bit row * KEYPAD_COLS + col
+    Keypad_Ring_t events; // events.overflows: events lost, queue full
 } Keypad_t;
 
 // Function Prototypes
 void Keypad_Init(Keypad_t* keypad, TIM_HandleTypeDef* htim);
-char Keypad_GetKey(Keypad_t* keypad);
-void Keypad_HandleInterrupt(Keypad_t* keypad, uint16_t GPIO_Pin); // Call in HAL_GPIO_EXTI_Callback
-void Keypad_TimerTick(Keypad_t* keypad); // Call in HAL_TIM_PeriodElapsedCallback
+bool Keypad_GetEvent(Keypad_t* keypad, Keypad_Event_t* event);
+char Keypad_GetKey(Keypad_t* keypad); // Next press (releases skipped), 0 if none
+bool Keypad_HasKey(Keypad_t* keypad); // Any event waiting
+void Keypad_Scan(Keypad_t* keypad); // Call from the main loop every KEYPAD_SCAN_MS
 
 #endif
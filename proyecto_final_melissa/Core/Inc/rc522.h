@@ -7,6 +7,7 @@
 #define RC522_H_
 
 #include "main.h" // Importante para tener acceso a HAL y definiciones de pines
+#include <stdbool.h>
 #include <stdint.h>
 
 // --- Definiciones de Hardware ---
@@ -28,11 +29,40 @@ extern SPI_HandleTypeDef hspi1;
 #define PICC_ANTICOLL 0x93
 #define PICC_SElECTTAG 0x93
 #define PICC_HALT 0x50
+// Niveles de cascada (ISO 14443-3A): ANTICOLL con NVB=0x20, SELECT con 0x70
+#define PICC_SEL_CL1 0x93
+#define PICC_SEL_CL2 0x95
+#define PICC_SEL_CL3 0x97
+#define PICC_CASCADE_TAG 0x88 // Primer byte del nivel cuando el UID sigue
+#define PICC_SAK_CASCADE 0x04 // Bit del SAK: UID incompleto
 
 // --- Códigos de Retorno ---
 #define MI_OK 0
 #define MI_NOTAGERR 1
 #define MI_ERR 2
+#define MI_COLLERR 3 // Colisión de bits: hay más de una tarjeta respondiendo
+
+// Capacidad del FIFO interno del MFRC522
+#define MFRC522_FIFO_SIZE 64
+
+// Reloj SPI máximo del MFRC522 (datasheet: 10 Mbit/s)
+#define MFRC522_SPI_MAX_HZ 10000000
+
+// --- Perfil de antena (se fija al compilar, ej. -DMFRC522_RX_GAIN=...) ---
+// Ganancia del receptor, RFCfgReg[6:4]
+#define MFRC522_GAIN_18DB 0x20
+#define MFRC522_GAIN_23DB 0x30
+#define MFRC522_GAIN_33DB 0x40
+#define MFRC522_GAIN_38DB 0x50
+#define MFRC522_GAIN_43DB 0x60
+#define MFRC522_GAIN_48DB 0x70
+#ifndef MFRC522_RX_GAIN
+#define MFRC522_RX_GAIN MFRC522_GAIN_48DB // Recomendado para clones
+#endif
+// Conductancia del driver de antena sin modulación (CWGsP, 0-63)
+#ifndef MFRC522_CW_GSP
+#define MFRC522_CW_GSP 0x20 // Valor por defecto del chip
+#endif
 
 // --- Registros MFRC522 (Selección de los más usados) ---
 // Page 0: Command and Status
@@ -84,16 +114,80 @@ extern SPI_HandleTypeDef hspi1;
 // Page 3: TestRegister
 #define MFRC522_REG_VERSION 0x37
 
+// Fin de una transferencia asíncrona (se llama desde MFRC522_Poll)
+typedef void (*MFRC522_Callback_t)(uint8_t status, uint8_t *backData,
+                                   uint16_t backBits);
+
+// UID completo (4, 7 o 10 bytes) y SAK de la tarjeta seleccionada. Los bytes
+// sin usar quedan en 0, así {size, bytes} sirve como clave de tamaño fijo.
+#define MFRC522_UID_MAX 10
+typedef struct {
+  uint8_t size;
+  uint8_t bytes[MFRC522_UID_MAX];
+  uint8_t sak;
+} MFRC522_Uid_t;
+
+// Fin de un SELECT asíncrono; 'uid' solo es válido si status == MI_OK
+typedef void (*MFRC522_UidCallback_t)(uint8_t status, const MFRC522_Uid_t *uid);
+// Fin de un inventario: 'count' tarjetas leídas en 'uids'
+typedef void (*MFRC522_InventoryCallback_t)(uint8_t count,
+                                            const MFRC522_Uid_t *uids);
+
 // --- Prototipos de Funciones ---
 void MFRC522_Init(void);
 void MFRC522_Reset(void);
 void MFRC522_AntennaOn(void);
 void MFRC522_AntennaOff(void);
+// Prueba el enlace SPI y elige el prescaler más rápido que pasa (ver rc522.c)
+bool MFRC522_AutoTune(void);
 uint8_t MFRC522_Request(uint8_t reqMode, uint8_t *TagType);
 uint8_t MFRC522_ToCard(uint8_t command, uint8_t *sendData, uint8_t sendLen,
                        uint8_t *backData, uint16_t *backLen);
 uint8_t MFRC522_Anticoll(uint8_t *serNum);
+// ANTICOLL/SELECT CL1-CL3 tras un Request: deja la tarjeta en ACTIVE
+uint8_t MFRC522_Select(MFRC522_Uid_t *uid);
+uint8_t MFRC522_Halt(void);
+// Lee y pone en HALT todas las tarjetas del campo (hasta 'max'); retorna
+// cuántas leyó. reqMode: PICC_REQIDL (solo nuevas) o PICC_REQALL (también
+// las que estaban en HALT)
+uint8_t MFRC522_Inventory(MFRC522_Uid_t *uids, uint8_t max, uint8_t reqMode);
+// WUPA + SELECT por UID + HALT: MI_OK si esa tarjeta sigue en el campo. La
+// deja en HALT, igual que al resto de las que estaban en HALT.
+uint8_t MFRC522_Confirm(const MFRC522_Uid_t *uid);
+
+// Versiones no bloqueantes: inician la transferencia y retornan (MI_ERR si
+// ya hay una en curso). MFRC522_Poll() la avanza desde el lazo principal.
+uint8_t MFRC522_ToCardAsync(uint8_t command, const uint8_t *sendData,
+                            uint8_t sendLen, uint8_t *backData,
+                            MFRC522_Callback_t callback);
+uint8_t MFRC522_RequestAsync(uint8_t reqMode, uint8_t *TagType,
+                             MFRC522_Callback_t callback);
+uint8_t MFRC522_AnticollAsync(uint8_t *serNum, MFRC522_Callback_t callback);
+uint8_t MFRC522_SelectAsync(MFRC522_Uid_t *uid, MFRC522_UidCallback_t callback);
+uint8_t MFRC522_HaltAsync(MFRC522_Callback_t callback);
+uint8_t MFRC522_InventoryAsync(MFRC522_Uid_t *uids, uint8_t max,
+                               uint8_t reqMode,
+                               MFRC522_InventoryCallback_t callback);
+uint8_t MFRC522_ConfirmAsync(const MFRC522_Uid_t *uid,
+                             MFRC522_UidCallback_t callback);
+void MFRC522_Poll(void);
+bool MFRC522_IsBusy(void);
+
+// Modo IRQ: el pin IRQ del chip (RC522_IRQ, EXTI) avisa el fin de cada
+// transferencia y MFRC522_Poll() no toca el SPI hasta entonces
+void MFRC522_EnableIrq(void);
+void MFRC522_HandleInterrupt(void); // Llamar desde HAL_GPIO_EXTI_Callback
+// Llegó un flanco que MFRC522_Poll() todavía no atendió (fuente del scheduler)
+bool MFRC522_IrqPending(void);
+// ms hasta que MFRC522_Poll() tenga algo que hacer sin flanco: el plazo de
+// software en modo IRQ, 1 sin IRQ, 0 si ya venció o no hay transferencia
+uint32_t MFRC522_PollDelay(void);
+// Transferencias en modo IRQ que terminó el plazo de software aunque el chip
+// ya había terminado (flanco perdido). Debe quedar en 0.
+uint32_t MFRC522_IrqLost(void);
 void MFRC522_WriteRegister(uint8_t addr, uint8_t val);
 uint8_t MFRC522_ReadRegister(uint8_t addr);
+void MFRC522_WriteFIFO(const uint8_t *data, uint8_t len);
+void MFRC522_ReadFIFO(uint8_t *data, uint8_t len);
 
 #endif /* RC522_H_ */
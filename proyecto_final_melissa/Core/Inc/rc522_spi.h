@@ -0,0 +1,55 @@
+/*
+ * rc522_spi.h
+ * Transporte SPI por DMA para el MFRC522: una cola de transferencias que se
+ * encadenan desde la interrupción de fin de DMA, sin huecos en el bus.
+ */
+
+#ifndef RC522_SPI_H_
+#define RC522_SPI_H_
+
+#include "main.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Capacidad de la cola (potencia de 2)
+#define RC522_SPI_QUEUE_LEN 16
+// Escrituras de hasta este tamaño se copian en la cola (registro + valor)
+#define RC522_SPI_INLINE_LEN 2
+
+// Fin de una transferencia; se llama desde la interrupción del DMA
+typedef void (*RC522_SPI_Callback_t)(bool ok, void *ctx);
+
+typedef struct {
+  const uint8_t *tx;
+  uint8_t *rx; // NULL: solo transmisión
+  uint16_t len;
+  RC522_SPI_Callback_t callback;
+  void *ctx;
+  uint8_t data[RC522_SPI_INLINE_LEN];
+} RC522_SPI_Xfer_t;
+
+void RC522_SPI_Init(SPI_HandleTypeDef *hspi, GPIO_TypeDef *csPort,
+                    uint16_t csPin);
+
+// Encola una transferencia y retorna. 'tx'/'rx' deben seguir vivos hasta
+// el callback. Sin DMA enlazado al SPI se ejecuta en el momento.
+void RC522_SPI_Submit(const uint8_t *tx, uint8_t *rx, uint16_t len,
+                      RC522_SPI_Callback_t callback, void *ctx);
+// Escritura corta: los datos se copian, el llamador no espera
+void RC522_SPI_Write(const uint8_t *tx, uint16_t len);
+// Bloqueante: espera su turno en la cola y el final de la transferencia
+bool RC522_SPI_Transfer(const uint8_t *tx, uint8_t *rx, uint16_t len);
+// Espera a que la cola se vacíe
+void RC522_SPI_Flush(void);
+
+// Velocidad del bus: SPI_BAUDRATEPRESCALER_x. Vacía la cola antes de cambiarla.
+bool RC522_SPI_SetPrescaler(uint32_t prescaler);
+uint32_t RC522_SPI_GetPrescaler(void);
+// true si hubo un error de bus desde la última llamada (y lo borra)
+bool RC522_SPI_TakeError(void);
+
+// Llamar desde HAL_SPI_TxCpltCallback/TxRxCpltCallback y HAL_SPI_ErrorCallback
+void RC522_SPI_CpltCallback(SPI_HandleTypeDef *hspi);
+void RC522_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#endif /* RC522_SPI_H_ */
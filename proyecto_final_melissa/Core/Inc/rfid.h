@@ -0,0 +1,64 @@
+/*
+ * rfid.h
+ * Planificador de sondeo del lector RFID y seguimiento de presencia de
+ * tarjetas.
+ *
+ * Sin tarjetas presentes, la antena está apagada entre sondeos: tras
+ * actividad (tecla o tarjeta) se sondea cada RFID_POLL_FAST_MS; pasado
+ * RFID_ACTIVE_WINDOW_MS sin actividad, cada RFID_POLL_SLOW_MS. La latencia
+ * máxima entre acercar una tarjeta y detectarla es RFID_POLL_SLOW_MS +
+ * RFID_FIELD_SETTLE_MS + la duración del inventario.
+ *
+ * Cada tarjeta leída queda en HALT y se recuerda (UID y hora). Mientras haya
+ * tarjetas presentes la antena sigue encendida para que no salgan de HALT:
+ * en cada sondeo se confirma cada recordada por su UID (WUPA, SELECT, HLTA)
+ * y luego un REQA, que solo contestan las nuevas. Una tarjeta se informa una
+ * sola vez mientras permanezca en el lector.
+ */
+
+#ifndef RFID_H_
+#define RFID_H_
+
+#include "rc522.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// --- Configuración (ms) ---
+#ifndef RFID_POLL_FAST_MS
+#define RFID_POLL_FAST_MS 50 // También el intervalo con tarjetas presentes
+#endif
+#ifndef RFID_POLL_SLOW_MS
+#define RFID_POLL_SLOW_MS 500 // Fija la latencia en el peor caso
+#endif
+#ifndef RFID_ACTIVE_WINDOW_MS
+#define RFID_ACTIVE_WINDOW_MS 10000
+#endif
+// Tiempo con el campo encendido antes del REQA (ISO 14443-3: la tarjeta
+// necesita hasta 5 ms para alimentarse)
+#ifndef RFID_FIELD_SETTLE_MS
+#define RFID_FIELD_SETTLE_MS 5
+#endif
+// Ausencia necesaria para dar una tarjeta por retirada (tolera fallos sueltos)
+#ifndef RFID_ABSENT_MS
+#define RFID_ABSENT_MS 200
+#endif
+
+// Tarjetas leídas por sondeo y recordadas a la vez
+#define RFID_MAX_CARDS 4
+
+// Tarjetas nuevas (no presentes en el sondeo anterior)
+typedef void (*RFID_Callback_t)(uint8_t count, const MFRC522_Uid_t *uids);
+
+// Llamar después de MFRC522_Init: apaga la antena hasta el primer sondeo
+void RFID_Init(RFID_Callback_t callback);
+// Avanza el sondeo y retorna los ms hasta la próxima llamada necesaria (el
+// próximo sondeo, el arranque del campo o el plazo de la transferencia); en
+// modo IRQ hay que llamarla también cuando MFRC522_IrqPending(). Con 'accept'
+// en false no se informan tarjetas nuevas (quedan para cuando vuelva a ser
+// true), pero se sigue vigilando la presencia de las recordadas. Si 'accept'
+// cambia o hay actividad, volver a llamarla sin esperar ese plazo.
+uint32_t RFID_Run(bool accept);
+// Actividad del usuario: vuelve al sondeo rápido
+void RFID_Activity(void);
+
+#endif /* RFID_H_ */
@@ -0,0 +1,61 @@
+#ifndef RING_H
+#define RING_H
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring buffer, for handing data
+// from one ISR to the main loop (or the other way round) without masking
+// interrupts. RING_DEFINE(Name, Type, Size) declares the type Name_t and
+// static inline Name_Push/Name_Pop/Name_IsEmpty for 'Type' elements.
+//
+// - Size must be a power of 2. head/tail run freely and wrap at 2^32, so
+//   all Size slots are usable.
+// - Only the producer writes head and overflows; only the consumer writes
+//   tail. __DMB gives the acquire/release ordering: the element is stored
+//   before head publishes it, and read before tail releases the slot.
+// - A push into a full ring drops the new element and counts it in
+//   'overflows'; nothing already queued is overwritten.
+// - Zero-initialised (static) storage is an empty ring.
+
+#define RING_DEFINE(Name, Type, Size)                                          \
+  _Static_assert((Size) > 0 && ((Size) & ((Size)-1)) == 0,                     \
+                 #Name " size must be a power of 2");                          \
+  typedef struct {                                                             \
+    volatile uint32_t head;      /* Next slot to write (producer) */           \
+    volatile uint32_t tail;      /* Next slot to read (consumer) */            \
+    volatile uint32_t overflows; /* Elements dropped, ring full */             \
+    Type buf[(Size)];                                                          \
+  } Name##_t;                                                                  \
+                                                                               \
+  static inline bool Name##_Push(Name##_t *ring, Type value) {                 \
+    uint32_t head = ring->head;                                                \
+    if (head - ring->tail >= (Size)) {                                         \
+      ring->overflows++;                                                       \
+      return false;                                                            \
+    }                                                                          \
+    __DMB(); /* Consumer is done with the slot before it is reused */          \
+    ring->buf[head & ((Size)-1)] = value;                                      \
+    __DMB(); /* Element stored before it is published */                       \
+    ring->head = head + 1;                                                     \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline bool Name##_Pop(Name##_t *ring, Type *value) {                 \
+    uint32_t tail = ring->tail;                                                \
+    if (ring->head == tail) {                                                  \
+      return false;                                                            \
+    }                                                                          \
+    __DMB(); /* head read before the element it publishes */                   \
+    *value = ring->buf[tail & ((Size)-1)];                                     \
+    __DMB(); /* Element read before the slot is released */                    \
+    ring->tail = tail + 1;                                                     \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline bool Name##_IsEmpty(const Name##_t *ring) {                    \
+    return ring->head == ring->tail;                                           \
+  }
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Run-to-completion scheduler: event sources (ISRs feeding lock-free rings,
+// see ring.h) and the expired timers of the timing wheel (timer_wheel.h).
+// Each handler runs to the end before the next one starts, so handlers must
+// not block; anything that has to wait arms a timer instead.
+
+#define SCHED_MAX_SOURCES 4
+
+typedef void (*Sched_Handler_t)(uint32_t arg);
+typedef bool (*Sched_Pending_t)(void);
+
+void Sched_Init(void);
+
+// Event source: 'handler(0)' runs whenever 'pending()' is true, typically
+// an ISR ring that is not empty; the handler drains it. Register from the
+// main loop at init. Returns false when all source slots are in use.
+bool Sched_AddSource(Sched_Pending_t pending, Sched_Handler_t handler);
+
+// One scheduler pass: expired timers, then sources. Sleeps (WFI) until the
+// next interrupt when there is nothing to do. Call from the main loop.
+void Sched_Dispatch(void);
+
+#endif
@@ -0,0 +1,133 @@
+// Generated by fsm_gen.py from state_machine.mmd. Do not edit.
+#ifndef STATE_MACHINE_FSM_H
+#define STATE_MACHINE_FSM_H
+
+typedef enum {
+  STATE_IDLE,
+  STATE_INPUT_CODE,
+  STATE_CHECK_CODE,
+  STATE_ACCESS_GRANTED,
+  STATE_ACCESS_DENIED,
+  STATE_BLOCKED,
+  STATE_CHANGE_PWD_AUTH,
+  STATE_CHANGE_PWD_NEW,
+  STATE_CHANGE_PWD_CONFIRM,
+  STATE_COUNT
+} SystemState_t;
+
+// Tables: included once, by state_machine.c
+#ifdef SM_FSM_TABLES
+#include "fsm.h"
+
+typedef enum {
+  EV_COMPLETION = FSM_EV_COMPLETION,
+  EV_KEY,
+  EV_KEY_A,
+  EV_TIMEOUT,
+  EV_CARD_OK,
+  EV_CARD_DENIED,
+  EV_DOOR_OPEN,
+  EV_DOOR_CLOSED,
+  EV_DOOR_ALERT,
+  EV_COUNTDOWN,
+  EV_UNLOCK,
+  EV_LOCK,
+  EV_COUNT
+} SM_Event_t;
+
+static bool SM_IsLastDigit(uint32_t arg);
+static bool SM_CodeMatches(uint32_t arg);
+static bool SM_IsLastAttempt(uint32_t arg);
+static bool SM_LastDigitMatches(uint32_t arg);
+static void SM_EnterIdle(uint32_t arg);
+static void SM_ExitState(uint32_t arg);
+static void SM_StoreDigit(uint32_t arg);
+static void SM_ShowUnauthorized(uint32_t arg);
+static void SM_EnterInputCode(uint32_t arg);
+static void SM_TypeDigit(uint32_t arg);
+static void SM_ResetAttempts(uint32_t arg);
+static void SM_CountFailure(uint32_t arg);
+static void SM_EnterGranted(uint32_t arg);
+static void SM_DoorOpened(uint32_t arg);
+static void SM_DoorClosed(uint32_t arg);
+static void SM_ShowDoorAlert(uint32_t arg);
+static void SM_EnterDenied(uint32_t arg);
+static void SM_EnterBlocked(uint32_t arg);
+static void SM_ShowRemaining(uint32_t arg);
+static void SM_EnterPwdAuth(uint32_t arg);
+static void SM_EnterPwdNew(uint32_t arg);
+static void SM_SavePassword(uint32_t arg);
+static void SM_EnterPwdConfirm(uint32_t arg);
+
+static const Fsm_StateDef_t SM_STATES[STATE_COUNT] = {
+    [STATE_IDLE] = {SM_EnterIdle, SM_ExitState},
+    [STATE_INPUT_CODE] = {SM_EnterInputCode, SM_ExitState},
+    [STATE_CHECK_CODE] = {NULL, NULL},
+    [STATE_ACCESS_GRANTED] = {SM_EnterGranted, SM_ExitState},
+    [STATE_ACCESS_DENIED] = {SM_EnterDenied, SM_ExitState},
+    [STATE_BLOCKED] = {SM_EnterBlocked, SM_ExitState},
+    [STATE_CHANGE_PWD_AUTH] = {SM_EnterPwdAuth, SM_ExitState},
+    [STATE_CHANGE_PWD_NEW] = {SM_EnterPwdNew, SM_ExitState},
+    [STATE_CHANGE_PWD_CONFIRM] = {SM_EnterPwdConfirm, SM_ExitState},
+};
+
+static const Fsm_Transition_t SM_TRANSITIONS[] = {
+    /*  0 */ {NULL, SM_StoreDigit, STATE_INPUT_CODE},
+    /*  1 */ {NULL, NULL, STATE_CHANGE_PWD_AUTH},
+    /*  2 */ {NULL, NULL, STATE_IDLE},
+    /*  3 */ {NULL, NULL, STATE_ACCESS_GRANTED},
+    /*  4 */ {NULL, SM_ShowUnauthorized, FSM_NO_TRANSITION},
+    /*  5 */ {SM_IsLastDigit, SM_TypeDigit, STATE_CHECK_CODE},
+    /*  6 */ {NULL, SM_TypeDigit, FSM_NO_TRANSITION},
+    /*  7 */ {SM_CodeMatches, SM_ResetAttempts, STATE_ACCESS_GRANTED},
+    /*  8 */ {SM_IsLastAttempt, SM_CountFailure, STATE_BLOCKED},
+    /*  9 */ {NULL, SM_CountFailure, STATE_ACCESS_DENIED},
+    /* 10 */ {NULL, SM_DoorOpened, FSM_NO_TRANSITION},
+    /* 11 */ {NULL, SM_DoorClosed, FSM_NO_TRANSITION},
+    /* 12 */ {NULL, SM_ShowDoorAlert, FSM_NO_TRANSITION},
+    /* 13 */ {NULL, SM_ResetAttempts, STATE_IDLE},
+    /* 14 */ {NULL, SM_ShowRemaining, FSM_NO_TRANSITION},
+    /* 15 */ {SM_LastDigitMatches, SM_TypeDigit, STATE_CHANGE_PWD_NEW},
+    /* 16 */ {SM_IsLastDigit, SM_TypeDigit, STATE_ACCESS_DENIED},
+    /* 17 */ {NULL, SM_TypeDigit, FSM_NO_TRANSITION},
+    /* 18 */ {SM_IsLastDigit, SM_SavePassword, STATE_CHANGE_PWD_CONFIRM},
+    /* 19 */ {NULL, SM_TypeDigit, FSM_NO_TRANSITION},
+};
+
+// Index of the first SM_TRANSITIONS entry per [state][event]
+static const uint8_t SM_CELLS[STATE_COUNT][EV_COUNT] = {
+    [STATE_IDLE] =
+        {FSM_NO_CELL, 0, 1, 2, 3, 4, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, 3, 2},
+    [STATE_INPUT_CODE] =
+        {FSM_NO_CELL, 5, 5, 2, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 3, 2},
+    [STATE_CHECK_CODE] =
+        {7, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 3, 2},
+    [STATE_ACCESS_GRANTED] =
+        {FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 2, FSM_NO_CELL, FSM_NO_CELL, 10,
+         11, 12, FSM_NO_CELL, 3, 2},
+    [STATE_ACCESS_DENIED] =
+        {FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 2, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 3, 2},
+    [STATE_BLOCKED] =
+        {FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 13, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 14, 3, 2},
+    [STATE_CHANGE_PWD_AUTH] =
+        {FSM_NO_CELL, 15, 15, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 3, 2},
+    [STATE_CHANGE_PWD_NEW] =
+        {FSM_NO_CELL, 18, 18, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 3, 2},
+    [STATE_CHANGE_PWD_CONFIRM] =
+        {FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 2, FSM_NO_CELL, FSM_NO_CELL,
+         FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, FSM_NO_CELL, 3, 2},
+};
+
+_Static_assert(sizeof(SM_TRANSITIONS) / sizeof(SM_TRANSITIONS[0]) < FSM_NO_CELL,
+               "SM_TRANSITIONS does not fit a byte index");
+_Static_assert(STATE_COUNT < FSM_NO_TRANSITION, "Too many states");
+#endif // SM_FSM_TABLES
+
+#endif
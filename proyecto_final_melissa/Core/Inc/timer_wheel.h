@@ -0,0 +1,48 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Timer service: a hierarchical timing wheel advanced by SysTick (1 ms).
+// Timers are caller-owned objects (one per named timeout), so arming,
+// re-arming and cancelling are O(1) list operations with no allocation.
+// Expired timers run their handler from Sched_Dispatch, never in the ISR.
+//
+// 4 levels of 64 slots: level 0 holds the next 64 ms, each level above
+// covers 64 times more. Timers are moved down a level when their slot
+// comes up, and the longest delay is TIMER_MAX_MS (about 4.6 hours).
+
+#define TIMER_LEVELS 4
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1u << TIMER_SLOT_BITS)
+#define TIMER_MAX_MS ((TIMER_SLOTS - 1) << ((TIMER_LEVELS - 1) * TIMER_SLOT_BITS))
+
+typedef void (*Timer_Handler_t)(uint32_t arg);
+
+typedef struct Timer {
+  struct Timer *next;
+  struct Timer **pprev; // NULL: not armed
+  uint32_t expires;     // Wheel time (ms)
+  uint32_t period;      // 0: one-shot
+  Timer_Handler_t handler;
+  uint32_t arg;
+} Timer_t;
+
+// Arm 't' to run 'handler(arg)' after 'ms' (once, or every 'ms' until
+// stopped). Re-arming a running timer restarts it.
+void Timer_Start(Timer_t *t, uint32_t ms, Timer_Handler_t handler,
+                 uint32_t arg);
+void Timer_StartPeriodic(Timer_t *t, uint32_t ms, Timer_Handler_t handler,
+                         uint32_t arg);
+// Cancel (also if it expired but its handler has not run yet)
+void Timer_Stop(Timer_t *t);
+bool Timer_IsArmed(const Timer_t *t);
+uint32_t Timer_Remaining(const Timer_t *t); // ms, 0 if not armed
+
+void Timer_Tick(void);        // Call from SysTick_Handler
+bool Timer_HasExpired(void);  // Expired timers waiting for Timer_RunExpired
+void Timer_RunExpired(void);  // Call from the main loop (Sched_Dispatch)
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+
+// Microsecond timing on the Cortex-M4 DWT cycle counter (CYCCNT).
+// The counter wraps every 2^32 cycles (~42.9 s at 100 MHz); delays and
+// deadlines must stay below half of that.
+
+void Timing_Init(void); // Call after SystemClock_Config (and after any clock change)
+void Timing_DelayUs(uint32_t us);
+uint32_t Timing_DeadlineUs(uint32_t us); // Deadline 'us' from now, for Timing_Expired
+bool Timing_Expired(uint32_t deadline);
+uint32_t Timing_ElapsedUs(uint32_t startCycles);
+uint32_t Timing_CyclesToUs(uint32_t cycles);
+
+// Raw cycle count, for elapsed-cycle measurements
+static inline uint32_t Timing_Cycles(void) { return DWT->CYCCNT; }
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef UART_LOG_H
+#define UART_LOG_H
+
+#include "stm32f4xx_hal.h"
+
+// Non-blocking UART log: text is copied into a ring buffer and sent by
+// interrupts in the background. When the ring is full the text is dropped.
+
+#define UART_LOG_BUFFER_LEN 512 // Power of 2
+
+void UartLog_Init(UART_HandleTypeDef *huart);
+void UartLog_Write(const char *str);
+// Call from HAL_UART_TxCpltCallback
+void UartLog_TxCpltCallback(UART_HandleTypeDef *huart);
+
+#endif
@@ -1,19 +1,40 @@
 	#include "LiquidCrystal_I2C.h"
+	#include "timing.h"
 	#include <string.h>
 
 	// Private function prototypes
 	static void send(LiquidCrystal_I2C_t *lcd, uint8_t value, uint8_t mode);
+	static void queueNibble(LiquidCrystal_I2C_t *lcd, uint8_t nibble, uint8_t mode);
+	static void queueCommand(LiquidCrystal_I2C_t *lcd, uint8_t value);
+	static void queueData(LiquidCrystal_I2C_t *lcd, uint8_t value);
+	static void flush(LiquidCrystal_I2C_t *lcd);
+	static void transmit(LiquidCrystal_I2C_t *lcd, const uint8_t *data, uint16_t len);
+	static void settle(LiquidCrystal_I2C_t *lcd, uint32_t us);
+	static bool readByte(LiquidCrystal_I2C_t *lcd, uint8_t mode, uint8_t *value);
+	static void waitReady(LiquidCrystal_I2C_t *lcd, uint32_t us);
+	static bool probeBusyFlag(LiquidCrystal_I2C_t *lcd);
+	static void queueRaw(LiquidCrystal_I2C_t *lcd, uint8_t data);
+	static bool isAsync(LiquidCrystal_I2C_t *lcd);
+	static void ringWrite(LiquidCrystal_I2C_t *lcd, const uint8_t *data, uint16_t len);
+	static void startDma(LiquidCrystal_I2C_t *lcd);
+	static uint16_t bfWaitDistance(LiquidCrystal_I2C_t *lcd, uint16_t tail);
+	static void bfNext(LiquidCrystal_I2C_t *lcd);
+	static void bfRelease(LiquidCrystal_I2C_t *lcd);
 	static void write4bits(LiquidCrystal_I2C_t *lcd, uint8_t value);
 	static void expanderWrite(LiquidCrystal_I2C_t *lcd, uint8_t _data);
-	static void pulseEnable(LiquidCrystal_I2C_t *lcd, uint8_t _data);
+	static void trackCommand(LiquidCrystal_I2C_t *lcd, uint8_t value);
+	static int16_t addrToCell(LiquidCrystal_I2C_t *lcd, uint8_t addr);
+	static uint8_t nextAddr(LiquidCrystal_I2C_t *lcd, uint8_t addr);
+	static void uploadGlyph(LiquidCrystal_I2C_t *lcd, uint8_t location, const uint8_t charmap[8]);
+	static uint32_t glyphHash(const uint8_t charmap[8]);
+	static bool glyphOnScreen(LiquidCrystal_I2C_t *lcd, uint8_t slot);
 
-	// Microsecond delay function
-	static inline void delayMicroseconds(uint32_t us) {
-		uint32_t cycles = (SystemCoreClock / 1000000) * us / 3;
-		while (cycles--) {
-			__NOP();
-		}
-	}
+	// DDRAM address of the first cell of each row (20x4 layout)
+	static const uint8_t row_offsets[LCD_MAX_ROWS] = {0x00, 0x40, 0x14, 0x54};
+
+	// Rows sorted by DDRAM address: row 0 runs straight into row 2 and row 1
+	// into row 3, so a commit in this order needs the fewest address moves
+	static const uint8_t commit_order[LCD_MAX_ROWS] = {0, 2, 1, 3};
 
 	void LiquidCrystal_I2C_init(LiquidCrystal_I2C_t *lcd, I2C_HandleTypeDef *hi2c,
 							   uint8_t lcd_Addr, uint8_t lcd_cols, uint8_t lcd_rows) {
@@ -23,6 +44,22 @@
 		lcd->_rows = lcd_rows;
 		lcd->_backlightval = LCD_BACKLIGHT;  // Start with backlight ON
 		lcd->_displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+		lcd->_ddramAddr = LCD_ADDR_UNKNOWN;
+		lcd->_txLen = 0;
+		lcd->_txMode = LCD_MODE_UNKNOWN;
+		lcd->_ringHead = 0;
+		lcd->_ringTail = 0;
+		lcd->_dmaLen = 0;
+		lcd->_txError = false;
+		lcd->_busyFlag = false;
+		lcd->_bfHead = 0;
+		lcd->_bfTail = 0;
+		lcd->_bfStep = 0;
+		lcd->_bfError = false;
+		memset(lcd->_glyphStamp, 0, sizeof(lcd->_glyphStamp));
+		lcd->_glyphClock = 0;
+		LiquidCrystal_I2C_fbClear(lcd);
+		memset(lcd->_shadow, ' ', LCD_FB_SIZE);
 		LiquidCrystal_I2C_begin(lcd, lcd->_cols, lcd->_rows, LCD_5x8DOTS);
 	}
 
@@ -37,26 +74,25 @@
 		}
 
 		// Wait for LCD to power up (>40ms after VCC rises to 4.5V)
-		HAL_Delay(50);
+		Timing_DelayUs(40000);
 
 		// Put the LCD into 4 bit mode according to HD44780 datasheet
 		// Start in 8bit mode, try to set 4 bit mode
 		expanderWrite(lcd, lcd->_backlightval);
-		HAL_Delay(1);
 
-		// Sequence to put into 4-bit mode
+		// Sequence to put into 4-bit mode (waits per HD44780 figure 24)
 		write4bits(lcd, 0x03 << 4);
-		delayMicroseconds(4500);
+		settle(lcd, 4100);
 
 		write4bits(lcd, 0x03 << 4);
-		delayMicroseconds(4500);
+		settle(lcd, 100);
 
 		write4bits(lcd, 0x03 << 4);
-		delayMicroseconds(150);
+		settle(lcd, 37);
 
 		// Finally, set to 4-bit interface
 		write4bits(lcd, 0x02 << 4);
-		delayMicroseconds(100);
+		settle(lcd, 37);
 
 		// Set # lines, font size, etc.
 		LiquidCrystal_I2C_command(lcd, LCD_FUNCTIONSET | lcd->_displayfunction);
@@ -72,23 +108,23 @@
 		lcd->_displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
 		LiquidCrystal_I2C_command(lcd, LCD_ENTRYMODESET | lcd->_displaymode);
 
+		// BF is only valid once the init sequence is done
+		lcd->_busyFlag = probeBusyFlag(lcd);
+
 		LiquidCrystal_I2C_home(lcd);
 	}
 
 	void LiquidCrystal_I2C_clear(LiquidCrystal_I2C_t *lcd) {
-		LiquidCrystal_I2C_command(lcd, LCD_CLEARDISPLAY);
-		HAL_Delay(2);  // Clear takes 1.52ms
+		queueCommand(lcd, LCD_CLEARDISPLAY);
+		settle(lcd, 1520);  // Clear takes 1.52ms
 	}
 
 	void LiquidCrystal_I2C_home(LiquidCrystal_I2C_t *lcd) {
-		LiquidCrystal_I2C_command(lcd, LCD_RETURNHOME);
-		HAL_Delay(2);  // Home takes 1.52ms
+		queueCommand(lcd, LCD_RETURNHOME);
+		settle(lcd, 1520);  // Home takes 1.52ms
 	}
 
 	void LiquidCrystal_I2C_setCursor(LiquidCrystal_I2C_t *lcd, uint8_t col, uint8_t row) {
-		// Row addresses for 20x4 LCD
-		int row_offsets[] = {0x00, 0x40, 0x14, 0x54};
-
 		if (row >= lcd->_numlines) {
 			row = lcd->_numlines - 1;
 		}
@@ -155,10 +191,62 @@
 
 	void LiquidCrystal_I2C_createChar(LiquidCrystal_I2C_t *lcd, uint8_t location, uint8_t charmap[]) {
 		location &= 0x7;  // Only 8 locations 0-7
-		LiquidCrystal_I2C_command(lcd, LCD_SETCGRAMADDR | (location << 3));
-		for (int i = 0; i < 8; i++) {
-			LiquidCrystal_I2C_write(lcd, charmap[i]);
+		uploadGlyph(lcd, location, charmap);
+	}
+
+	void LiquidCrystal_I2C_showScreen(LiquidCrystal_I2C_t *lcd, const LCD_Screen_t *screen) {
+		LiquidCrystal_I2C_fbClear(lcd);
+		for (uint8_t row = 0; row < LCD_MAX_ROWS && row < lcd->_rows; row++) {
+			LiquidCrystal_I2C_fbSetCursor(lcd, 0, row);
+			LiquidCrystal_I2C_fbPrint(lcd, screen->rows[row]);
 		}
+		LiquidCrystal_I2C_fbSetCursor(lcd, 0, 0);
+
+		// The stream was encoded for this exact geometry and backlight state
+		if (lcd->_cols != LCD_MAX_COLS || lcd->_rows != LCD_MAX_ROWS ||
+			lcd->_backlightval != LCD_BACKLIGHT) {
+			LiquidCrystal_I2C_commit(lcd);
+			return;
+		}
+
+		flush(lcd);
+		transmit(lcd, screen->stream, screen->len);
+		memcpy(lcd->_shadow, lcd->_frame, LCD_FB_SIZE);
+		lcd->_txMode = Rs;
+		lcd->_ddramAddr = nextAddr(lcd, row_offsets[3] + LCD_MAX_COLS - 1);
+	}
+
+	uint8_t LiquidCrystal_I2C_glyph(LiquidCrystal_I2C_t *lcd, const uint8_t charmap[8]) {
+		uint32_t hash = glyphHash(charmap);
+		uint8_t victim = 0;
+		bool victimShown = true;
+
+		for (uint8_t slot = 0; slot < LCD_GLYPH_SLOTS; slot++) {
+			if (lcd->_glyphStamp[slot] != 0 && lcd->_glyphHash[slot] == hash &&
+				memcmp(lcd->_glyphMap[slot], charmap, 8) == 0) {
+				lcd->_glyphStamp[slot] = ++lcd->_glyphClock;
+				return slot;
+			}
+		}
+
+		// Miss: take a free slot, else the least recently used one that the
+		// frame being drawn does not show (rewriting it would change those
+		// cells too), else the least recently used overall
+		for (uint8_t slot = 0; slot < LCD_GLYPH_SLOTS; slot++) {
+			if (lcd->_glyphStamp[slot] == 0) {
+				victim = slot;
+				break;
+			}
+			bool shown = glyphOnScreen(lcd, slot);
+			if (slot == 0 || (victimShown && !shown) ||
+				(shown == victimShown && lcd->_glyphStamp[slot] < lcd->_glyphStamp[victim])) {
+				victim = slot;
+				victimShown = shown;
+			}
+		}
+
+		uploadGlyph(lcd, victim, charmap);
+		return victim;
 	}
 
 	void LiquidCrystal_I2C_noBacklight(LiquidCrystal_I2C_t *lcd) {
@@ -172,42 +260,517 @@
 	}
 
 	void LiquidCrystal_I2C_command(LiquidCrystal_I2C_t *lcd, uint8_t value) {
-		send(lcd, value, 0);
+		queueCommand(lcd, value);
+		flush(lcd);
 	}
 
 	void LiquidCrystal_I2C_write(LiquidCrystal_I2C_t *lcd, uint8_t value) {
-		send(lcd, value, Rs);
+		queueData(lcd, value);
+		flush(lcd);
 	}
 
 	void LiquidCrystal_I2C_print(LiquidCrystal_I2C_t *lcd, const char *str) {
 		while (*str) {
-			LiquidCrystal_I2C_write(lcd, *str++);
+			queueData(lcd, *str++);
+		}
+		flush(lcd);
+	}
+
+	// ==================== Framebuffer ====================
+
+	void LiquidCrystal_I2C_fbClear(LiquidCrystal_I2C_t *lcd) {
+		memset(lcd->_frame, ' ', LCD_FB_SIZE);
+		lcd->_fbCol = 0;
+		lcd->_fbRow = 0;
+	}
+
+	void LiquidCrystal_I2C_fbSetCursor(LiquidCrystal_I2C_t *lcd, uint8_t col, uint8_t row) {
+		if (row >= lcd->_numlines) {
+			row = lcd->_numlines - 1;
+		}
+		lcd->_fbCol = col;
+		lcd->_fbRow = row;
+	}
+
+	void LiquidCrystal_I2C_fbWrite(LiquidCrystal_I2C_t *lcd, uint8_t value) {
+		// Characters past the right edge are dropped, like a clipped print
+		if (lcd->_fbCol < lcd->_cols) {
+			lcd->_frame[lcd->_fbRow * LCD_MAX_COLS + lcd->_fbCol] = value;
+			lcd->_fbCol++;
 		}
 	}
 
+	void LiquidCrystal_I2C_fbPrint(LiquidCrystal_I2C_t *lcd, const char *str) {
+		while (*str) {
+			LiquidCrystal_I2C_fbWrite(lcd, *str++);
+		}
+	}
+
+	void LiquidCrystal_I2C_commit(LiquidCrystal_I2C_t *lcd) {
+		if (lcd->_txError) {
+			// Part of an earlier update never reached the display: redraw all
+			lcd->_txError = false;
+			for (uint8_t i = 0; i < LCD_FB_SIZE; i++) {
+				lcd->_shadow[i] = lcd->_frame[i] ^ 0xFF;
+			}
+			lcd->_ddramAddr = LCD_ADDR_UNKNOWN;
+		}
+
+		for (uint8_t i = 0; i < LCD_MAX_ROWS; i++) {
+			uint8_t row = commit_order[i];
+			if (row >= lcd->_rows) {
+				continue;
+			}
+
+			for (uint8_t col = 0; col < lcd->_cols; col++) {
+				uint8_t cell = row * LCD_MAX_COLS + col;
+				if (lcd->_frame[cell] == lcd->_shadow[cell]) {
+					continue;
+				}
+
+				uint8_t addr = row_offsets[row] + col;
+				if (lcd->_ddramAddr != addr) {
+					// A one-cell gap costs the same to rewrite as to skip with
+					// an address move, so bridge it and keep the run going
+					int16_t gap = -1;
+					if (lcd->_ddramAddr != LCD_ADDR_UNKNOWN &&
+						nextAddr(lcd, lcd->_ddramAddr) == addr) {
+						gap = addrToCell(lcd, lcd->_ddramAddr);
+					}
+					if (gap >= 0) {
+						queueData(lcd, lcd->_frame[gap]);
+					} else {
+						queueCommand(lcd, LCD_SETDDRAMADDR | addr);
+					}
+				}
+				queueData(lcd, lcd->_frame[cell]);
+			}
+		}
+		flush(lcd);
+	}
+
+	// ==================== DMA Transmit ====================
+
+	void LiquidCrystal_I2C_TxCpltCallback(LiquidCrystal_I2C_t *lcd) {
+		if (lcd->_bfStep != 0) {
+			bfNext(lcd);
+			return;
+		}
+		lcd->_ringTail = (lcd->_ringTail + lcd->_dmaLen) & (LCD_RING_SIZE - 1);
+		lcd->_dmaLen = 0;
+		startDma(lcd);  // Chain the next chunk, if any
+	}
+
+	void LiquidCrystal_I2C_RxCpltCallback(LiquidCrystal_I2C_t *lcd) {
+		if (lcd->_bfStep != 0) {
+			bfNext(lcd);
+		}
+	}
+
+	void LiquidCrystal_I2C_ErrorCallback(LiquidCrystal_I2C_t *lcd) {
+		if (lcd->_bfStep != 0) {
+			lcd->_bfError = true;
+			bfNext(lcd);  // Finish the strobes anyway, as readByte does
+			return;
+		}
+		// Drop the failed chunk rather than retrying a missing/NACKing device
+		lcd->_ringTail = (lcd->_ringTail + lcd->_dmaLen) & (LCD_RING_SIZE - 1);
+		lcd->_dmaLen = 0;
+		lcd->_txError = true;
+		startDma(lcd);
+	}
+
 	// ==================== Private Functions ====================
 
+	static void queueCommand(LiquidCrystal_I2C_t *lcd, uint8_t value) {
+		send(lcd, value, 0);
+		trackCommand(lcd, value);
+	}
+
+	static void queueData(LiquidCrystal_I2C_t *lcd, uint8_t value) {
+		send(lcd, value, Rs);
+
+		// Keep the shadow in sync so direct writes and commits can be mixed
+		if (lcd->_ddramAddr == LCD_ADDR_UNKNOWN) {
+			return;
+		}
+		int16_t cell = addrToCell(lcd, lcd->_ddramAddr);
+		if (cell >= 0) {
+			lcd->_shadow[cell] = value;
+			lcd->_frame[cell] = value;
+		}
+		if (lcd->_displaymode & LCD_ENTRYLEFT) {
+			lcd->_ddramAddr = nextAddr(lcd, lcd->_ddramAddr);
+		} else {
+			lcd->_ddramAddr = LCD_ADDR_UNKNOWN;
+		}
+	}
+
+	// Mirror the effect of a command on the tracked address counter/shadow
+	static void trackCommand(LiquidCrystal_I2C_t *lcd, uint8_t value) {
+		// The instruction is identified by its highest set bit
+		if (value >= LCD_SETDDRAMADDR) {
+			lcd->_ddramAddr = value & 0x7F;
+		} else if (value >= LCD_SETCGRAMADDR) {
+			lcd->_ddramAddr = LCD_ADDR_UNKNOWN;
+		} else if (value >= LCD_FUNCTIONSET) {
+			// No effect on DDRAM
+		} else if (value >= LCD_CURSORSHIFT) {
+			if (!(value & LCD_DISPLAYMOVE)) {
+				lcd->_ddramAddr = LCD_ADDR_UNKNOWN;
+			}
+		} else if (value >= LCD_ENTRYMODESET) {
+			// Display control / entry mode: no effect on DDRAM
+		} else if (value >= LCD_RETURNHOME) {
+			lcd->_ddramAddr = 0;
+		} else if (value == LCD_CLEARDISPLAY) {
+			memset(lcd->_shadow, ' ', LCD_FB_SIZE);
+			memset(lcd->_frame, ' ', LCD_FB_SIZE);
+			lcd->_ddramAddr = 0;
+		}
+	}
+
+	// Write a bitmap to CGRAM and record it as resident in the glyph cache
+	static void uploadGlyph(LiquidCrystal_I2C_t *lcd, uint8_t location, const uint8_t charmap[8]) {
+		queueCommand(lcd, LCD_SETCGRAMADDR | (location << 3));
+		for (int i = 0; i < 8; i++) {
+			queueData(lcd, charmap[i]);
+		}
+		flush(lcd);
+
+		memcpy(lcd->_glyphMap[location], charmap, 8);
+		lcd->_glyphHash[location] = glyphHash(charmap);
+		lcd->_glyphStamp[location] = ++lcd->_glyphClock;
+	}
+
+	// FNV-1a over the 8 pixel rows
+	static uint32_t glyphHash(const uint8_t charmap[8]) {
+		uint32_t hash = 2166136261u;
+		for (int i = 0; i < 8; i++) {
+			hash = (hash ^ charmap[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	// Codes 8-15 show the same CGRAM slots as 0-7
+	static bool glyphOnScreen(LiquidCrystal_I2C_t *lcd, uint8_t slot) {
+		for (uint16_t i = 0; i < LCD_FB_SIZE; i++) {
+			if (lcd->_frame[i] < 16 && (lcd->_frame[i] & 0x07) == slot) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Framebuffer index of a DDRAM address, -1 if the address is off screen
+	static int16_t addrToCell(LiquidCrystal_I2C_t *lcd, uint8_t addr) {
+		for (uint8_t row = 0; row < lcd->_rows && row < LCD_MAX_ROWS; row++) {
+			if (addr >= row_offsets[row] && addr < row_offsets[row] + lcd->_cols) {
+				return row * LCD_MAX_COLS + (addr - row_offsets[row]);
+			}
+		}
+		return -1;
+	}
+
+	// Address counter after one write in increment mode
+	static uint8_t nextAddr(LiquidCrystal_I2C_t *lcd, uint8_t addr) {
+		if (lcd->_numlines > 1) {
+			if (addr == 0x27) {
+				return 0x40;
+			}
+			if (addr == 0x67) {
+				return 0x00;
+			}
+		} else if (addr == 0x4F) {
+			return 0x00;
+		}
+		return addr + 1;
+	}
+
 	static void send(LiquidCrystal_I2C_t *lcd, uint8_t value, uint8_t mode) {
-		uint8_t highnib = value & 0xF0;
-		uint8_t lownib = (value << 4) & 0xF0;
-		write4bits(lcd, highnib | mode);
-		write4bits(lcd, lownib | mode);
+		// Worst case is 6 bytes (setup + two strobes per nibble)
+		if (lcd->_txLen + 6 > LCD_TXBUF_SIZE) {
+			flush(lcd);
+		}
+		queueNibble(lcd, value & 0xF0, mode);
+		queueNibble(lcd, (value << 4) & 0xF0, mode);
 	}
 
-	static void write4bits(LiquidCrystal_I2C_t *lcd, uint8_t value) {
-		expanderWrite(lcd, value);
-		pulseEnable(lcd, value);
+	// One I2C byte lasts ~90us at 100kHz (~23us at 400kHz), so the bus itself
+	// provides the HD44780 timings: E stays high for a whole byte (>450ns) and
+	// the next instruction is latched at least two bytes later (>37us).
+	static void queueNibble(LiquidCrystal_I2C_t *lcd, uint8_t nibble, uint8_t mode) {
+		uint8_t data = nibble | mode | lcd->_backlightval;
+
+		// RS/RW must be stable before E rises; only needs its own byte on change
+		if (lcd->_txMode != mode) {
+			lcd->_txBuf[lcd->_txLen++] = data;
+			lcd->_txMode = mode;
+		}
+		lcd->_txBuf[lcd->_txLen++] = data | En;
+		lcd->_txBuf[lcd->_txLen++] = data;  // Falling edge latches the nibble
 	}
 
-	static void expanderWrite(LiquidCrystal_I2C_t *lcd, uint8_t _data) {
-		uint8_t data = _data | lcd->_backlightval;
-		HAL_I2C_Master_Transmit(lcd->hi2c, lcd->_Addr, &data, 1, 100);
+	static void queueRaw(LiquidCrystal_I2C_t *lcd, uint8_t data) {
+		if (lcd->_txLen >= LCD_TXBUF_SIZE) {
+			flush(lcd);
+		}
+		lcd->_txBuf[lcd->_txLen++] = data;
+	}
+
+	static void flush(LiquidCrystal_I2C_t *lcd) {
+		if (lcd->_txLen == 0) {
+			return;
+		}
+		transmit(lcd, lcd->_txBuf, lcd->_txLen);
+		lcd->_txLen = 0;
+	}
+
+	// Hand encoded bytes to the bus: DMA ring, or one blocking transaction
+	static void transmit(LiquidCrystal_I2C_t *lcd, const uint8_t *data, uint16_t len) {
+		if (isAsync(lcd)) {
+			ringWrite(lcd, data, len);
+		} else {
+			HAL_I2C_Master_Transmit(lcd->hi2c, lcd->_Addr, (uint8_t *)data, len, 100);
+		}
+	}
+
+	// Wait for a slow instruction, then flush. Long waits poll BF when the
+	// backpack supports it: blocking mode reads it here, with DMA the ring
+	// stops at this point until the interrupts read BF clear. Other waits
+	// with DMA are paid with idle expander bytes (E low) on the bus. Either
+	// way the caller never blocks in async mode.
+	static void settle(LiquidCrystal_I2C_t *lcd, uint32_t us) {
+		uint8_t next = (lcd->_bfHead + 1) % LCD_BF_WAITS;
+
+		if (isAsync(lcd) && lcd->_busyFlag && us >= LCD_BF_MIN_WAIT_US &&
+			next != lcd->_bfTail) {
+			flush(lcd);
+			lcd->_bfWait[lcd->_bfHead].pos = lcd->_ringHead;
+			lcd->_bfWait[lcd->_bfHead].us = us;
+			lcd->_bfWait[lcd->_bfHead].mode = lcd->_txMode == LCD_MODE_UNKNOWN ? 0 : lcd->_txMode;
+			lcd->_bfHead = next;
+			startDma(lcd);  // The ring may have drained already
+			return;
+		}
+
+		if (!isAsync(lcd)) {
+			flush(lcd);
+			if (lcd->_busyFlag && us >= LCD_BF_MIN_WAIT_US) {
+				waitReady(lcd, us);
+			} else {
+				Timing_DelayUs(us);
+			}
+			return;
+		}
+
+		// One byte takes 9 SCL periods (8 data bits + ACK)
+		uint32_t pad = (us * (lcd->hi2c->Init.ClockSpeed / 1000) + 8999) / 9000;
+		uint8_t idle = (lcd->_txMode == LCD_MODE_UNKNOWN ? 0 : lcd->_txMode) | lcd->_backlightval;
+		while (pad--) {
+			queueRaw(lcd, idle);
+		}
+		flush(lcd);
+	}
+
+	// Read a byte back from the HD44780 (mode 0: BF + address counter).
+	// The PCF8574 pins are quasi-bidirectional: writing 1s to D4-D7 turns
+	// them into inputs, then each nibble is sampled while E is high.
+	static bool readByte(LiquidCrystal_I2C_t *lcd, uint8_t mode, uint8_t *value) {
+		uint8_t idle = 0xF0 | mode | Rw | lcd->_backlightval;
+		uint8_t strobe[2] = {idle, idle | En};
+		uint8_t high = 0, low = 0;
+		bool ok = true;
+
+		// Both E pulses go out even if a read fails, or the 4-bit interface
+		// loses nibble sync. With RW tied low they write command 0xFF instead
+		// (Set DDRAM Address 0x7F): the transfers still succeed, so the caller
+		// has to drop the tracked address when the result makes no sense.
+		ok &= HAL_I2C_Master_Transmit(lcd->hi2c, lcd->_Addr, strobe, 2, 10) == HAL_OK;
+		ok &= HAL_I2C_Master_Receive(lcd->hi2c, lcd->_Addr, &high, 1, 10) == HAL_OK;
+		ok &= HAL_I2C_Master_Transmit(lcd->hi2c, lcd->_Addr, strobe, 2, 10) == HAL_OK;
+		ok &= HAL_I2C_Master_Receive(lcd->hi2c, lcd->_Addr, &low, 1, 10) == HAL_OK;
+		ok &= HAL_I2C_Master_Transmit(lcd->hi2c, lcd->_Addr, &idle, 1, 10) == HAL_OK;
+
+		lcd->_txMode = mode | Rw;  // Next write emits a setup byte with RW low
+		if (!ok) {
+			lcd->_ddramAddr = LCD_ADDR_UNKNOWN;
+			return false;
+		}
+		*value = (high & 0xF0) | (low >> 4);
+		return true;
+	}
+
+	// Poll BF until the controller is ready. 'us' is the datasheet worst case:
+	// if a read fails or BF is still set after twice that, stop trusting it.
+	static void waitReady(LiquidCrystal_I2C_t *lcd, uint32_t us) {
+		uint32_t deadline = Timing_DeadlineUs(us * 2);
+		uint8_t status;
+
+		while (lcd->_busyFlag) {
+			if (!readByte(lcd, 0, &status) || Timing_Expired(deadline)) {
+				lcd->_busyFlag = false;
+				Timing_DelayUs(us);
+				return;
+			}
+			if (!(status & LCD_BUSYFLAG)) {
+				return;
+			}
+		}
+	}
+
+	// Backpacks with RW tied low just read back what we drove: check that the
+	// address counter really follows a Set DDRAM Address command
+	static bool probeBusyFlag(LiquidCrystal_I2C_t *lcd) {
+	#if LCD_USE_BUSY_FLAG
+		uint8_t status;
+
+		queueCommand(lcd, LCD_SETDDRAMADDR | 0x0A);
+		settle(lcd, 37);
+		// The read below is blocking: let the DMA finish the stream first
+		while (lcd->_ringHead != lcd->_ringTail || lcd->_dmaLen != 0 ||
+			   lcd->_bfTail != lcd->_bfHead) {
+			startDma(lcd);
+		}
+		if (readByte(lcd, 0, &status) && status == 0x0A) {
+			return true;
+		}
+		lcd->_ddramAddr = LCD_ADDR_UNKNOWN;  // Probably moved to 0x7F, see readByte
+		return false;
+	#else
+		(void)lcd;
+		return false;
+	#endif
+	}
+
+	static bool isAsync(LiquidCrystal_I2C_t *lcd) {
+		return lcd->hi2c->hdmatx != NULL;
+	}
+
+	static void ringWrite(LiquidCrystal_I2C_t *lcd, const uint8_t *data, uint16_t len) {
+		for (uint16_t i = 0; i < len; i++) {
+			uint16_t next = (lcd->_ringHead + 1) & (LCD_RING_SIZE - 1);
+			while (next == lcd->_ringTail) {
+				startDma(lcd);  // Ring full: only blocks until the DMA frees space
+			}
+			lcd->_ring[lcd->_ringHead] = data[i];
+			lcd->_ringHead = next;
+		}
+		startDma(lcd);
+	}
+
+	// Start a transfer of the contiguous bytes at the ring tail if the DMA is
+	// idle, stopping at the next BF wait (or reading BF when it is reached).
+	// Called from thread mode and from the completion interrupts.
+	static void startDma(LiquidCrystal_I2C_t *lcd) {
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+
+		uint16_t head = lcd->_ringHead;
+		uint16_t tail = lcd->_ringTail;
+		uint16_t until = bfWaitDistance(lcd, tail);
+		if (lcd->_dmaLen == 0 && lcd->_bfStep == 0 && until == 0) {
+			// Status read: the five transfers of readByte, chained by bfNext
+			uint8_t idle = 0xF0 | Rw | lcd->_backlightval;
+			lcd->_bfIo[0] = idle;
+			lcd->_bfIo[1] = idle | En;
+			lcd->_bfIo[2] = idle;
+			lcd->_bfIo[3] = lcd->_bfWait[lcd->_bfTail].mode | lcd->_backlightval;
+			lcd->_bfDeadline = Timing_DeadlineUs(lcd->_bfWait[lcd->_bfTail].us * 2);
+			lcd->_bfError = false;
+			lcd->_bfStep = 1;
+			bfNext(lcd);
+		} else if (lcd->_dmaLen == 0 && lcd->_bfStep == 0 && head != tail) {
+			uint16_t len = (head > tail) ? head - tail : LCD_RING_SIZE - tail;
+			if (len > until) {
+				len = until;
+			}
+			lcd->_dmaLen = len;
+			if (HAL_I2C_Master_Transmit_DMA(lcd->hi2c, lcd->_Addr, &lcd->_ring[tail], len) != HAL_OK) {
+				lcd->_dmaLen = 0;  // Peripheral busy, retried on the next call
+			}
+		}
+
+		if (!primask) {
+			__enable_irq();
+		}
+	}
+
+	// Ring bytes left before the oldest queued BF wait (LCD_RING_SIZE if none).
+	// Waits queued before BF was given up are dropped; their instruction may
+	// not have finished, so the next commit redraws everything.
+	static uint16_t bfWaitDistance(LiquidCrystal_I2C_t *lcd, uint16_t tail) {
+		while (lcd->_bfTail != lcd->_bfHead) {
+			uint16_t until = (lcd->_bfWait[lcd->_bfTail].pos - tail) & (LCD_RING_SIZE - 1);
+			if (until != 0 || lcd->_busyFlag) {
+				return until;
+			}
+			lcd->_bfTail = (lcd->_bfTail + 1) % LCD_BF_WAITS;
+			lcd->_txError = true;
+		}
+		return LCD_RING_SIZE;
+	}
+
+	// Next transfer of the status read, from the I2C completion interrupts.
+	// Like readByte, every strobe goes out even after a failed transfer. At
+	// the end: BF clear releases the ring, BF set reads again; a failed read
+	// or BF still set past twice the datasheet wait stops trusting BF (after
+	// a failure what follows may reach a busy controller: redraw it all).
+	static void bfNext(LiquidCrystal_I2C_t *lcd) {
+		HAL_StatusTypeDef status;
+
+		do {
+			switch (lcd->_bfStep++) {
+			case 1:
+			case 3:
+				status = HAL_I2C_Master_Transmit_IT(lcd->hi2c, lcd->_Addr, &lcd->_bfIo[0], 2);
+				break;
+			case 2:
+				status = HAL_I2C_Master_Receive_IT(lcd->hi2c, lcd->_Addr, &lcd->_bfNibble[0], 1);
+				break;
+			case 4:
+				status = HAL_I2C_Master_Receive_IT(lcd->hi2c, lcd->_Addr, &lcd->_bfNibble[1], 1);
+				break;
+			case 5:
+				status = HAL_I2C_Master_Transmit_IT(lcd->hi2c, lcd->_Addr, &lcd->_bfIo[2], 2);
+				break;
+			default:
+				if (lcd->_bfError) {
+					lcd->_busyFlag = false;
+					lcd->_txError = true;
+					bfRelease(lcd);
+				} else if (!(lcd->_bfNibble[0] & LCD_BUSYFLAG)) {
+					bfRelease(lcd);
+				} else if (Timing_Expired(lcd->_bfDeadline)) {
+					lcd->_busyFlag = false;
+					bfRelease(lcd);
+				} else {
+					lcd->_bfStep = 1;
+					bfNext(lcd);
+				}
+				return;
+			}
+			if (status != HAL_OK) {
+				lcd->_bfError = true;
+			}
+		} while (status != HAL_OK);  // Else the next step runs from the interrupt
+	}
+
+	// The oldest BF wait is over: carry on with the ring
+	static void bfRelease(LiquidCrystal_I2C_t *lcd) {
+		lcd->_bfTail = (lcd->_bfTail + 1) % LCD_BF_WAITS;
+		lcd->_bfStep = 0;
+		startDma(lcd);
 	}
 
-	static void pulseEnable(LiquidCrystal_I2C_t *lcd, uint8_t _data) {
-		expanderWrite(lcd, _data | En);
-		delayMicroseconds(1);  // Enable pulse must be >450ns
+	// Single nibble, only used by the 8-bit mode init sequence
+	static void write4bits(LiquidCrystal_I2C_t *lcd, uint8_t value) {
+		queueNibble(lcd, value & 0xF0, value & (Rs | Rw));
+		flush(lcd);
+	}
 
-		expanderWrite(lcd, _data & ~En);
-		delayMicroseconds(50);  // Command needs >37us to settle
+	static void expanderWrite(LiquidCrystal_I2C_t *lcd, uint8_t _data) {
+		queueRaw(lcd, _data | lcd->_backlightval);
+		lcd->_txMode = _data & (Rs | Rw);
+		flush(lcd);
 	}
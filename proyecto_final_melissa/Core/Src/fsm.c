@@ -0,0 +1,43 @@
+#include "fsm.h"
+
+void Fsm_Init(Fsm_t *fsm, const Fsm_StateDef_t *states, const uint8_t *cells,
+              const Fsm_Transition_t *transitions, uint8_t eventCount,
+              uint8_t initial) {
+  fsm->states = states;
+  fsm->cells = cells;
+  fsm->transitions = transitions;
+  fsm->eventCount = eventCount;
+  fsm->state = initial;
+}
+
+void Fsm_Dispatch(Fsm_t *fsm, uint8_t event, uint32_t arg) {
+  for (uint8_t hop = 0; hop <= FSM_MAX_CHAIN; hop++) {
+    uint8_t cell = fsm->cells[fsm->state * fsm->eventCount + event];
+    if (cell == FSM_NO_CELL) {
+      return; // Not handled in this state
+    }
+    const Fsm_Transition_t *t = &fsm->transitions[cell];
+    while (t->guard != NULL && !t->guard(arg)) {
+      t++;
+    }
+
+    if (t->next == FSM_NO_TRANSITION) {
+      if (t->action != NULL) {
+        t->action(arg);
+      }
+      return;
+    }
+
+    if (fsm->states[fsm->state].exit != NULL) {
+      fsm->states[fsm->state].exit(arg);
+    }
+    if (t->action != NULL) {
+      t->action(arg);
+    }
+    fsm->state = t->next;
+    if (fsm->states[fsm->state].entry != NULL) {
+      fsm->states[fsm->state].entry(arg);
+    }
+    event = FSM_EV_COMPLETION;
+  }
+}
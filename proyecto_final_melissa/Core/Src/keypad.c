@@ -1,4 +1,5 @@
 #include "keypad.h"
+#include <string.h>
 
 // Keypad Layout
 const char KEYMAP[KEYPAD_ROWS][KEYPAD_COLS] = {{'1', '4', '7', '*'},
@@ -8,77 +9,120 @@ const char KEYMAP[KEYPAD_ROWS][KEYPAD_COLS] = {{'1', '4', '7', '*'},
 
 void Keypad_Init(Keypad_t *keypad, TIM_HandleTypeDef *htim) {
   keypad->Timer = htim;
-  keypad->currentColumn = 0;
-  keypad->newKeyAvailable = false;
-  keypad->lastKey = 0;
-  keypad->lastDebounceTime = 0;
+  keypad->readIndex = 0;
+  keypad->lastScan = HAL_GetTick();
+  keypad->busy = 0;
+  memset(keypad->integrator, 0, sizeof(keypad->integrator));
+  keypad->pressed = 0;
+  keypad->events.head = 0;
+  keypad->events.tail = 0;
+  keypad->events.overflows = 0;
+
+  // Column pattern per update: release column i, drive column i + 1 LOW
+  for (int i = 0; i < KEYPAD_COLS; i++) {
+    int next = (i + 1) % KEYPAD_COLS;
+    keypad->columnTable[i] =
+        keypad->ColPins[i] | ((uint32_t)keypad->ColPins[next] << 16);
+  }
 
   // Initialize Columns: All HIGH (Inactive) initially
   for (int i = 0; i < KEYPAD_COLS; i++) {
     HAL_GPIO_WritePin(keypad->ColPorts[i], keypad->ColPins[i], GPIO_PIN_SET);
   }
 
-  // Start with Column 0 Active (LOW)
+  // Start with Column 0 Active (LOW): the first period samples it, the first
+  // update moves to column 1
   HAL_GPIO_WritePin(keypad->ColPorts[0], keypad->ColPins[0], GPIO_PIN_RESET);
 
-  // Start Timer for cycling columns
-  HAL_TIM_Base_Start_IT(keypad->Timer);
+  // Both streams are circular and raise no interrupts. Started before the
+  // counter, so sample i and column i % KEYPAD_COLS stay in step.
+  HAL_DMA_Start(htim->hdma[TIM_DMA_ID_UPDATE], (uint32_t)keypad->columnTable,
+                (uint32_t)&keypad->ColPorts[0]->BSRR, KEYPAD_COLS);
+  HAL_DMA_Start(htim->hdma[TIM_DMA_ID_CC1], (uint32_t)&keypad->RowPorts[0]->IDR,
+                (uint32_t)keypad->samples, KEYPAD_SAMPLES);
+  __HAL_TIM_ENABLE_DMA(htim, TIM_DMA_UPDATE | TIM_DMA_CC1);
+  HAL_TIM_OC_Start(htim, TIM_CHANNEL_1);
+}
+
+bool Keypad_GetEvent(Keypad_t *keypad, Keypad_Event_t *event) {
+  return Keypad_Ring_Pop(&keypad->events, event);
 }
 
 char Keypad_GetKey(Keypad_t *keypad) {
-  if (keypad->newKeyAvailable) {
-    keypad->newKeyAvailable = false;
-    return keypad->lastKey;
+  Keypad_Event_t event;
+  while (Keypad_Ring_Pop(&keypad->events, &event)) {
+    if (event.pressed) {
+      return event.key;
+    }
   }
   return 0;
 }
 
-// Called by Timer ISR (e.g., every 20ms)
-void Keypad_TimerTick(Keypad_t *keypad) {
-  // 1. Deactivate current column (Set HIGH)
-  HAL_GPIO_WritePin(keypad->ColPorts[keypad->currentColumn],
-                    keypad->ColPins[keypad->currentColumn], GPIO_PIN_SET);
+bool Keypad_HasKey(Keypad_t *keypad) {
+  return !Keypad_Ring_IsEmpty(&keypad->events);
+}
 
-  // 2. Move to next column
-  keypad->currentColumn++;
-  if (keypad->currentColumn >= KEYPAD_COLS) {
-    keypad->currentColumn = 0;
-  }
+static void Keypad_Emit(Keypad_t *keypad, uint8_t row, uint8_t col,
+                        bool pressed, uint32_t time) {
+  Keypad_Event_t event = {KEYMAP[row][col], pressed, time};
+  Keypad_Ring_Push(&keypad->events, event);
+}
+
+// Integrating debounce per key: count up while down, down while up; the
+// state only flips at the ends, so bounces just slow the count
+static void Keypad_Integrate(Keypad_t *keypad, uint8_t col, uint16_t idr,
+                             uint32_t time) {
+  for (uint8_t row = 0; row < KEYPAD_ROWS; row++) {
+    uint8_t *count = &keypad->integrator[row][col];
+    uint16_t bit = 1u << (row * KEYPAD_COLS + col);
 
-  // 3. Activate new column (Set LOW)
-  HAL_GPIO_WritePin(keypad->ColPorts[keypad->currentColumn],
-                    keypad->ColPins[keypad->currentColumn], GPIO_PIN_RESET);
+    if ((idr & keypad->RowPins[row]) == 0) {
+      keypad->busy |= bit;
+      if (*count < KEYPAD_DEBOUNCE_SAMPLES &&
+          ++*count == KEYPAD_DEBOUNCE_SAMPLES && !(keypad->pressed & bit)) {
+        keypad->pressed |= bit;
+        Keypad_Emit(keypad, row, col, true, time);
+      }
+    } else if (*count > 0 && --*count == 0) {
+      keypad->busy &= ~bit;
+      if (keypad->pressed & bit) {
+        keypad->pressed &= ~bit;
+        Keypad_Emit(keypad, row, col, false, time);
+      }
+    }
+  }
 }
 
-// Called by EXTI ISR
-void Keypad_HandleInterrupt(Keypad_t *keypad, uint16_t GPIO_Pin) {
-  // Simple Debounce: Ignore interrupts if too close to the last one
+// Go through the samples the DMA wrote since the last call. An idle matrix
+// (every row HIGH, nothing counting) is skipped with one compare per sample.
+void Keypad_Scan(Keypad_t *keypad) {
+  DMA_HandleTypeDef *dma = keypad->Timer->hdma[TIM_DMA_ID_CC1];
+  uint16_t write =
+      (KEYPAD_SAMPLES - __HAL_DMA_GET_COUNTER(dma)) % KEYPAD_SAMPLES;
   uint32_t now = HAL_GetTick();
-  if (now - keypad->lastDebounceTime < 200) {
-    return;
+
+  // The DMA may have lapped the reader (first call after the boot delays, or
+  // a stalled main loop): what is left is a wrapped, stale history, so start
+  // again from the current position
+  if (now - keypad->lastScan >= KEYPAD_SAMPLES - KEYPAD_COLS) {
+    keypad->readIndex = write;
   }
+  keypad->lastScan = now;
 
-  // Identify Row
-  int row = -1;
-  for (int i = 0; i < KEYPAD_ROWS; i++) {
-    if (GPIO_Pin == keypad->RowPins[i]) {
-      row = i;
-      break;
-    }
+  uint16_t rows = 0;
+  for (uint8_t row = 0; row < KEYPAD_ROWS; row++) {
+    rows |= keypad->RowPins[row];
   }
 
-  if (row != -1) {
-    // We know the Row (from Pin) and the Column (from currentColumn)
-    // Note: Since we cycle columns, if we are here, it means the Row is LOW
-    // AND the current active Column is LOW. So this is a valid intersection.
-
-    // Double check: Is the Row actually LOW? (Falling edge trigger implies it
-    // went low)
-    if (HAL_GPIO_ReadPin(keypad->RowPorts[row], keypad->RowPins[row]) ==
-        GPIO_PIN_RESET) {
-      keypad->lastKey = KEYMAP[row][keypad->currentColumn];
-      keypad->newKeyAvailable = true;
-      keypad->lastDebounceTime = now;
+  while (keypad->readIndex != write) {
+    uint16_t i = keypad->readIndex;
+    uint16_t idr = keypad->samples[i];
+
+    if ((idr & rows) != rows || keypad->busy != 0) {
+      // One sample per ms: the one just before 'write' is ~1 ms old
+      uint16_t age = (write + KEYPAD_SAMPLES - i) % KEYPAD_SAMPLES;
+      Keypad_Integrate(keypad, i % KEYPAD_COLS, idr, now - age);
     }
+    keypad->readIndex = (i + 1) % KEYPAD_SAMPLES;
   }
 }
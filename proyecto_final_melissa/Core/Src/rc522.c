@@ -4,6 +4,9 @@
  */
 
 #include "rc522.h"
+#include "rc522_spi.h"
+#include "timing.h"
+#include <string.h>
 // include "spi.h"  // Necesario para hspi1
 
 // --- CONFIGURACIÓN DE PINES (AJUSTAR AQUI SI CAMBIAS EL HARDWARE) ---
@@ -15,29 +18,139 @@
 #define RC522_RST_PORT GPIOB
 #define RC522_RST_PIN GPIO_PIN_0
 
+// Margen sobre el timer interno del chip (TReload 1000 x 25us = 25ms)
+#define MFRC522_TIMEOUT_US 30000
+
+// Límite de espera del coprocesador CRC (unos pocos bytes)
+#define MFRC522_CRC_TIMEOUT_US 1000
+
+// Límite de espera del arranque del oscilador / soft reset
+#define MFRC522_RESET_TIMEOUT_US 50000
+
+// --- Autoajuste del SPI ---
+// Rondas de patrones que debe pasar sin un solo error cada prescaler
+#define MFRC522_TUNE_ROUNDS 8
+// Patrones de escritura/lectura: bits alternados, nibbles y todos a 0/1
+static const uint8_t MFRC522_TUNE_PATTERNS[] = {0x55, 0xAA, 0x0F, 0xF0,
+                                                0x00, 0xFF, 0x5A, 0xA5};
+
+// --- Secuencia de inicialización ---
+// Registro, valor y espera opcional tras la escritura. Se envía de un tirón:
+// las escrituras se encolan en el DMA una detrás de otra.
+typedef struct {
+  uint8_t reg;
+  uint8_t val;
+  uint16_t delayUs;
+} MFRC522_InitStep_t;
+
+static const MFRC522_InitStep_t MFRC522_INIT_TABLE[] = {
+    // Configuración del Timer (Según librería original)
+    // TPrescaler*TreloadVal/13.56MHz = tiempo espera
+    {MFRC522_REG_T_MODE, 0x80, 0},      // Tauto=1
+    {MFRC522_REG_T_PRESCALER, 0xA9, 0}, // Prescaler
+    {MFRC522_REG_T_RELOAD_H, 0x03, 0},  // Reload High
+    {MFRC522_REG_T_RELOAD_L, 0xE8, 0},  // Reload Low
+
+    {MFRC522_REG_TX_AUTO, 0x40, 0}, // 100% ASK
+    {MFRC522_REG_MODE, 0x3D, 0},    // CRC 0x6363
+
+    // Perfil de antena (ver rc522.h)
+    {MFRC522_REG_RF_CFG, MFRC522_RX_GAIN, 0},
+    {MFRC522_REG_CWGS_P, MFRC522_CW_GSP, 0},
+
+    {MFRC522_REG_TX_CONTROL, 0x83, 0}, // Antena encendida (Tx1RFEn, Tx2RFEn)
+};
+
+// --- Caché de registros ---
+// Registros de configuración que solo cambia este driver: se guardan al
+// escribir (write-through) y al leer, y luego se leen sin SPI. Los de estado
+// (COMMAND, COMM_IRQ, DIV_IRQ, ERROR, STATUS*, FIFO_*, CONTROL, COLL,
+// contador del timer, CRC, VERSION) los cambia el chip y nunca se cachean.
+#define REG_BIT(reg) (1ULL << (reg))
+#define MFRC522_CACHED_REGS                                                    \
+  (REG_BIT(MFRC522_REG_COMM_IE_N) | REG_BIT(MFRC522_REG_DIV1_EN) |             \
+   REG_BIT(MFRC522_REG_WATER_LEVEL) | REG_BIT(MFRC522_REG_BIT_FRAMING) |       \
+   REG_BIT(MFRC522_REG_MODE) | REG_BIT(MFRC522_REG_TX_MODE) |                  \
+   REG_BIT(MFRC522_REG_RX_MODE) | REG_BIT(MFRC522_REG_TX_CONTROL) |            \
+   REG_BIT(MFRC522_REG_TX_AUTO) | REG_BIT(MFRC522_REG_TX_SELL) |               \
+   REG_BIT(MFRC522_REG_RX_SELL) | REG_BIT(MFRC522_REG_RX_THRESHOLD) |          \
+   REG_BIT(MFRC522_REG_DEMOD) | REG_BIT(MFRC522_REG_MIFARE) |                  \
+   REG_BIT(MFRC522_REG_MOD_WIDTH) | REG_BIT(MFRC522_REG_RF_CFG) |              \
+   REG_BIT(MFRC522_REG_GS_N) | REG_BIT(MFRC522_REG_CWGS_P) |                   \
+   REG_BIT(MFRC522_REG_MODGS_P) | REG_BIT(MFRC522_REG_T_MODE) |                \
+   REG_BIT(MFRC522_REG_T_PRESCALER) | REG_BIT(MFRC522_REG_T_RELOAD_H) |        \
+   REG_BIT(MFRC522_REG_T_RELOAD_L))
+
+static uint8_t regCache[64];
+static uint64_t regValid = 0; // Bit n: regCache[n] refleja el chip
+
+// Tras un reset los registros vuelven a sus valores por defecto
+static void MFRC522_InvalidateCache(void) { regValid = 0; }
+
 // --- Funciones de Bajo Nivel (SPI) ---
 
+// Las escrituras se encolan y retornan enseguida (el DMA las encadena); las
+// lecturas esperan su turno, así el orden en el bus es el del programa.
 void MFRC522_WriteRegister(uint8_t addr, uint8_t val) {
   // Formato: Dirección desplazada + 0 en MSB (Write)
-  uint8_t addr_bits = (addr << 1) & 0x7E;
+  uint8_t tx[2] = {(addr << 1) & 0x7E, val};
 
-  HAL_GPIO_WritePin(RC522_CS_PORT, RC522_CS_PIN, GPIO_PIN_RESET); // Select
-  HAL_SPI_Transmit(&hspi1, &addr_bits, 1, 500);
-  HAL_SPI_Transmit(&hspi1, &val, 1, 500);
-  HAL_GPIO_WritePin(RC522_CS_PORT, RC522_CS_PIN, GPIO_PIN_SET); // Deselect
+  if (MFRC522_CACHED_REGS & REG_BIT(addr)) {
+    regCache[addr] = val;
+    regValid |= REG_BIT(addr);
+  }
+  RC522_SPI_Write(tx, 2);
 }
 
 uint8_t MFRC522_ReadRegister(uint8_t addr) {
-  uint8_t rx_bits;
-  // Formato: Dirección desplazada + 1 en MSB (Read)
-  uint8_t addr_bits = ((addr << 1) & 0x7E) | 0x80;
+  // Formato: Dirección desplazada + 1 en MSB (Read), luego un byte de relleno
+  uint8_t tx[2] = {((addr << 1) & 0x7E) | 0x80, 0x00};
+  uint8_t rx[2] = {0, 0};
+
+  if (regValid & REG_BIT(addr)) {
+    return regCache[addr];
+  }
+
+  RC522_SPI_Transfer(tx, rx, 2);
+  if (MFRC522_CACHED_REGS & REG_BIT(addr)) {
+    regCache[addr] = rx[1];
+    regValid |= REG_BIT(addr);
+  }
+  return rx[1];
+}
+
+// Ráfaga de escritura: la dirección va una sola vez y todos los datos siguen
+// en la misma ventana de NSS (el chip no incrementa la dirección)
+void MFRC522_WriteFIFO(const uint8_t *data, uint8_t len) {
+  uint8_t tx[MFRC522_FIFO_SIZE + 1];
+
+  if (len > MFRC522_FIFO_SIZE) {
+    len = MFRC522_FIFO_SIZE;
+  }
+  tx[0] = (MFRC522_REG_FIFO_DATA << 1) & 0x7E;
+  memcpy(&tx[1], data, len);
+
+  RC522_SPI_Transfer(tx, NULL, len + 1);
+}
+
+// Ráfaga de lectura: cada byte enviado es la dirección de la siguiente
+// lectura, el último es 0x00 para terminar. El dato llega desplazado un byte.
+void MFRC522_ReadFIFO(uint8_t *data, uint8_t len) {
+  uint8_t tx[MFRC522_FIFO_SIZE + 1];
+  uint8_t rx[MFRC522_FIFO_SIZE + 1];
+
+  if (len == 0) {
+    return;
+  }
+  if (len > MFRC522_FIFO_SIZE) {
+    len = MFRC522_FIFO_SIZE;
+  }
+  memset(tx, ((MFRC522_REG_FIFO_DATA << 1) & 0x7E) | 0x80, len);
+  tx[len] = 0x00;
 
-  HAL_GPIO_WritePin(RC522_CS_PORT, RC522_CS_PIN, GPIO_PIN_RESET); // Select
-  HAL_SPI_Transmit(&hspi1, &addr_bits, 1, 500);
-  HAL_SPI_Receive(&hspi1, &rx_bits, 1, 500);
-  HAL_GPIO_WritePin(RC522_CS_PORT, RC522_CS_PIN, GPIO_PIN_SET); // Deselect
+  RC522_SPI_Transfer(tx, rx, len + 1);
 
-  return rx_bits;
+  memcpy(data, &rx[1], len);
 }
 
 void MFRC522_SetBitMask(uint8_t reg, uint8_t mask) {
@@ -54,18 +167,38 @@ void MFRC522_ClearBitMask(uint8_t reg, uint8_t mask) {
 
 // --- Funciones de Control del Módulo ---
 
+static bool MFRC522_WaitReady(void);
+
 void MFRC522_Reset(void) {
+  MFRC522_InvalidateCache();
+
   // Hard Reset
   // RST pin: High = Reset/PowerDown, Low = Normal Operation
   HAL_GPIO_WritePin(RC522_RST_PORT, RC522_RST_PIN, GPIO_PIN_SET); // Reset
-  HAL_Delay(10);
+  Timing_DelayUs(1); // Pulso minimo de 100ns
   HAL_GPIO_WritePin(RC522_RST_PORT, RC522_RST_PIN,
                     GPIO_PIN_RESET); // Release Reset (Work)
-  HAL_Delay(50);
+  MFRC522_WaitReady(); // Arranque del oscilador
 
   // Soft Reset
   MFRC522_WriteRegister(MFRC522_REG_COMMAND, PCD_RESETPHASE);
-  HAL_Delay(50);
+  MFRC522_InvalidateCache();
+  MFRC522_WaitReady();
+}
+
+// Espera a que el chip termine de arrancar en lugar de un retardo fijo.
+// CommandReg vale 0x20 al salir del reset (RcvOff=1) y PowerDown se lee en 1
+// mientras dura el arranque; exigir RcvOff evita aceptar un MISO flotante
+// (0x00/0xFF). Si no responde, la espera termina en el peor caso anterior.
+static bool MFRC522_WaitReady(void) {
+  uint32_t deadline = Timing_DeadlineUs(MFRC522_RESET_TIMEOUT_US);
+
+  do {
+    if ((MFRC522_ReadRegister(MFRC522_REG_COMMAND) & 0x30) == 0x20) {
+      return true;
+    }
+  } while (!Timing_Expired(deadline));
+  return false;
 }
 
 void MFRC522_AntennaOn(void) {
@@ -81,56 +214,168 @@ void MFRC522_AntennaOff(void) {
 }
 
 void MFRC522_Init(void) {
+  RC522_SPI_Init(&hspi1, RC522_CS_PORT, RC522_CS_PIN);
   MFRC522_Reset();
+  MFRC522_AutoTune();
+
+  for (uint8_t i = 0;
+       i < sizeof(MFRC522_INIT_TABLE) / sizeof(MFRC522_INIT_TABLE[0]); i++) {
+    const MFRC522_InitStep_t *step = &MFRC522_INIT_TABLE[i];
+    MFRC522_WriteRegister(step->reg, step->val);
+    if (step->delayUs != 0) {
+      RC522_SPI_Flush(); // La espera cuenta desde que el valor llegó al chip
+      Timing_DelayUs(step->delayUs);
+    }
+  }
+}
 
-  // Configuración del Timer (Según librería original)
-  // TPrescaler*TreloadVal/13.56MHz = tiempo espera
-  MFRC522_WriteRegister(MFRC522_REG_T_MODE, 0x80);      // Tauto=1
-  MFRC522_WriteRegister(MFRC522_REG_T_PRESCALER, 0xA9); // Prescaler
-  MFRC522_WriteRegister(MFRC522_REG_T_RELOAD_H, 0x03);  // Reload High
-  MFRC522_WriteRegister(MFRC522_REG_T_RELOAD_L, 0xE8);  // Reload Low
+// --- Autoajuste del SPI ---
+// Acceso directo, sin la caché: la prueba tiene que ver lo que hay en el chip
+static uint8_t MFRC522_RawRead(uint8_t addr) {
+  uint8_t tx[2] = {((addr << 1) & 0x7E) | 0x80, 0x00};
+  uint8_t rx[2] = {0, 0};
 
-  MFRC522_WriteRegister(MFRC522_REG_TX_AUTO, 0x40); // 100% ASK
-  MFRC522_WriteRegister(MFRC522_REG_MODE, 0x3D);    // CRC 0x6363
+  RC522_SPI_Transfer(tx, rx, 2);
+  return rx[1];
+}
 
-  // Aumentar ganancia de antena (Opcional, pero recomendado para clones)
-  MFRC522_WriteRegister(MFRC522_REG_RF_CFG, 0x70); // 48dB Gain
+static void MFRC522_RawWrite(uint8_t addr, uint8_t val) {
+  uint8_t tx[2] = {(addr << 1) & 0x7E, val};
 
-  MFRC522_AntennaOn();
+  RC522_SPI_Transfer(tx, NULL, 2);
 }
 
-uint8_t MFRC522_ToCard(uint8_t command, uint8_t *sendData, uint8_t sendLen,
-                       uint8_t *backData, uint16_t *backLen) {
-  uint8_t status = MI_ERR;
-  uint8_t irqEn = 0x00;
-  uint8_t waitIRq = 0x00;
-  uint8_t lastBits;
-  uint8_t n;
-  uint16_t i;
+// VERSION igual a la de referencia y cada patrón escrito en ModWidthReg
+// (sin efecto fuera de una transmisión) se lee de vuelta igual
+static bool MFRC522_LinkTest(uint8_t version) {
+  for (uint8_t round = 0; round < MFRC522_TUNE_ROUNDS; round++) {
+    if (MFRC522_RawRead(MFRC522_REG_VERSION) != version) {
+      return false;
+    }
+    for (uint8_t i = 0; i < sizeof(MFRC522_TUNE_PATTERNS); i++) {
+      MFRC522_RawWrite(MFRC522_REG_MOD_WIDTH, MFRC522_TUNE_PATTERNS[i]);
+      if (MFRC522_RawRead(MFRC522_REG_MOD_WIDTH) != MFRC522_TUNE_PATTERNS[i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// La referencia se toma al prescaler más lento (256). Luego se prueba desde
+// el más rápido que respeta MFRC522_SPI_MAX_HZ con el PCLK2 actual, bajando.
+// Para dejar margen se usa un paso más lento que el primero que pasa todas
+// las rondas, y ese también tiene que pasarlas (el 256 vale solo). Si ninguno
+// cumple (o el chip no responde) se queda el más lento. Retorna false en ese
+// caso.
+bool MFRC522_AutoTune(void) {
+  uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+  uint8_t fastest = 0; // BR: f = PCLK2 / 2^(BR+1)
+  bool ok = false;
+
+  while (fastest < 7 && (pclk >> (fastest + 1)) > MFRC522_SPI_MAX_HZ) {
+    fastest++;
+  }
+
+  RC522_SPI_SetPrescaler(SPI_BAUDRATEPRESCALER_256);
+  uint8_t version = MFRC522_RawRead(MFRC522_REG_VERSION);
+  uint8_t modWidth = MFRC522_RawRead(MFRC522_REG_MOD_WIDTH);
+
+  if (version != 0x00 && version != 0xFF) { // Sin chip MISO queda fijo
+    bool fasterPassed = false; // El prescaler anterior también pasó
+    for (uint8_t br = fastest; br <= 7; br++) {
+      RC522_SPI_SetPrescaler((uint32_t)br << SPI_CR1_BR_Pos);
+      if (!MFRC522_LinkTest(version)) {
+        fasterPassed = false;
+        continue;
+      }
+      if (fasterPassed || br == 7) {
+        ok = true;
+        break;
+      }
+      fasterPassed = true;
+    }
+  }
+
+  // Ya en la velocidad elegida: ModWidthReg vuelve a su valor
+  MFRC522_RawWrite(MFRC522_REG_MOD_WIDTH, modWidth);
+  return ok;
+}
+
+// --- Transceive asíncrono ---
+// Una sola transferencia en curso. MFRC522_Poll() lee COMM_IRQ una vez por
+// llamada; al terminar se valida el resultado y se llama al callback.
+
+static struct {
+  volatile bool busy;
+  uint8_t command;
+  uint8_t irqEn;
+  uint8_t waitIRq;
+  uint32_t deadline;
+  uint8_t *backData;
+  uint16_t backLen; // En bits
+  uint8_t status;
+  uint8_t (*check)(uint8_t status); // Validación propia de Request/Anticoll
+  MFRC522_Callback_t callback;
+} xfer;
+
+static bool irqMode = false;
+static volatile bool irqPending = false;
+static uint32_t irqLost = 0; // Terminadas por el plazo con el chip ya listo
+
+static void MFRC522_Finish(uint8_t irq);
+static void MFRC522_Wait(void);
+static uint8_t MFRC522_CheckRequest(uint8_t status);
+static uint8_t MFRC522_CheckAnticoll(uint8_t status);
+
+uint8_t MFRC522_ToCardAsync(uint8_t command, const uint8_t *sendData,
+                            uint8_t sendLen, uint8_t *backData,
+                            MFRC522_Callback_t callback) {
+  if (xfer.busy) {
+    return MI_ERR;
+  }
+
+  xfer.command = command;
+  xfer.irqEn = 0x00;
+  xfer.waitIRq = 0x00;
+  xfer.backData = backData;
+  xfer.backLen = 0;
+  xfer.status = MI_ERR;
+  xfer.check = NULL;
+  xfer.callback = callback;
 
   switch (command) {
   case PCD_AUTHENT:
-    irqEn = 0x12;
-    waitIRq = 0x10;
+    xfer.irqEn = 0x12;
+    xfer.waitIRq = 0x10;
     break;
+  // Solo fuentes que terminan la transferencia (más ErrIRq): TxIRq o
+  // LoAlertIRq bajarían el pin IRQ a mitad de camino, sin nada que leer
   case PCD_TRANSCEIVE:
-    irqEn = 0x77;
-    waitIRq = 0x30;
+    xfer.irqEn = 0x33; // RxIRq, IdleIRq, ErrIRq, TimerIRq
+    xfer.waitIRq = 0x30;
+    break;
+  case PCD_TRANSMIT:
+    xfer.irqEn = 0x13; // IdleIRq, ErrIRq, TimerIRq
+    xfer.waitIRq = 0x50; // TxIRq, IdleIRq: no se espera respuesta
     break;
   default:
     break;
   }
 
-  MFRC522_WriteRegister(MFRC522_REG_COMM_IE_N, irqEn | 0x80);
-  MFRC522_ClearBitMask(MFRC522_REG_COMM_IRQ, 0x80);
-  MFRC522_SetBitMask(MFRC522_REG_FIFO_LEVEL, 0x80); // FlushBuffer
+  // IRqInv=1: el pin IRQ baja cuando se activa alguna fuente habilitada.
+  // El flag se limpia antes que las fuentes del chip, nunca se pierde un flanco.
+  irqPending = false;
+  MFRC522_WriteRegister(MFRC522_REG_COMM_IE_N, xfer.irqEn | 0x80);
+  // Escrituras directas, sin leer antes: con Set1=0 se borran todos los bits
+  // de COMM_IRQ escritos en 1, y en FIFO_LEVEL solo FlushBuffer es escribible
+  MFRC522_WriteRegister(MFRC522_REG_COMM_IRQ, 0x7F);
+  MFRC522_WriteRegister(MFRC522_REG_FIFO_LEVEL, 0x80); // FlushBuffer
 
   MFRC522_WriteRegister(MFRC522_REG_COMMAND, PCD_IDLE);
 
-  // Escribir datos
-  for (i = 0; i < sendLen; i++) {
-    MFRC522_WriteRegister(MFRC522_REG_FIFO_DATA, sendData[i]);
-  }
+  // Escribir datos (una sola transacción SPI)
+  MFRC522_WriteFIFO(sendData, sendLen);
 
   // Ejecutar comando
   MFRC522_WriteRegister(MFRC522_REG_COMMAND, command);
@@ -138,81 +383,641 @@ uint8_t MFRC522_ToCard(uint8_t command, uint8_t *sendData, uint8_t sendLen,
     MFRC522_SetBitMask(MFRC522_REG_BIT_FRAMING, 0x80); // StartSend
   }
 
-  // Esperar a que termine
-  i = 25000;
-  do {
-    n = MFRC522_ReadRegister(MFRC522_REG_COMM_IRQ);
-    i--;
-  } while ((i != 0) && !(n & 0x01) && !(n & waitIRq));
+  xfer.deadline = Timing_DeadlineUs(MFRC522_TIMEOUT_US);
+  xfer.busy = true;
+  return MI_OK;
+}
 
-  MFRC522_ClearBitMask(MFRC522_REG_BIT_FRAMING, 0x80); // StopSend
+void MFRC522_Poll(void) {
+  if (!xfer.busy) {
+    irqPending = false; // Flanco sin transferencia: nada que despertar
+    return;
+  }
 
-  if (i != 0) {
-    if (!(MFRC522_ReadRegister(MFRC522_REG_ERROR) & 0x1B)) {
-      status = MI_OK;
-      if (n & irqEn & 0x01) {
-        status = MI_NOTAGERR;
+  // En modo IRQ, sin flanco no hay nada que leer (el timeout sigue vigente)
+  if (irqMode && !irqPending && !Timing_Expired(xfer.deadline)) {
+    return;
+  }
+  irqPending = false;
+
+  uint8_t n = MFRC522_ReadRegister(MFRC522_REG_COMM_IRQ);
+  bool done = (n & 0x01) || (n & xfer.waitIRq);
+  if (!done && !Timing_Expired(xfer.deadline)) {
+    if (irqMode && (n & xfer.irqEn)) {
+      // Despertó una fuente que no termina (ErrIRq): se reconoce para que el
+      // pin suba y el final dé un flanco nuevo. Si otra fuente se activó
+      // entretanto el pin sigue bajo, así que se vuelve a mirar.
+      MFRC522_WriteRegister(MFRC522_REG_COMM_IRQ, n & xfer.irqEn);
+      if (MFRC522_ReadRegister(MFRC522_REG_COMM_IRQ) & xfer.irqEn) {
+        irqPending = true;
       }
+    }
+    return; // Todavía en curso
+  }
+  if (irqMode && done && Timing_Expired(xfer.deadline)) {
+    irqLost++; // El chip terminó pero el flanco no llegó
+  }
 
-      if (command == PCD_TRANSCEIVE) {
-        n = MFRC522_ReadRegister(MFRC522_REG_FIFO_LEVEL);
-        lastBits = MFRC522_ReadRegister(MFRC522_REG_CONTROL) & 0x07;
-        if (lastBits) {
-          *backLen = (n - 1) * 8 + lastBits;
-        } else {
-          *backLen = n * 8;
-        }
-
-        if (n == 0)
-          n = 1;
-        if (n > 16)
-          n = 16;
-
-        for (i = 0; i < n; i++) {
-          backData[i] = MFRC522_ReadRegister(MFRC522_REG_FIFO_DATA);
-        }
-      }
+  MFRC522_Finish(n);
+  if (xfer.check != NULL) {
+    xfer.status = xfer.check(xfer.status);
+  }
+
+  // Libre antes del callback, para que pueda encadenar otra transferencia
+  xfer.busy = false;
+  if (xfer.callback != NULL) {
+    xfer.callback(xfer.status, xfer.backData, xfer.backLen);
+  }
+}
+
+void MFRC522_EnableIrq(void) {
+  MFRC522_WriteRegister(MFRC522_REG_DIV1_EN, 0x80); // IRQPushPull
+  irqMode = true;
+}
+
+void MFRC522_HandleInterrupt(void) { irqPending = true; }
+
+bool MFRC522_IrqPending(void) { return irqPending; }
+
+uint32_t MFRC522_PollDelay(void) {
+  if (!xfer.busy) {
+    return 0;
+  }
+  if (!irqMode) {
+    return 1; // Sin flanco, COMM_IRQ se lee en cada tick
+  }
+  if (Timing_Expired(xfer.deadline)) {
+    return 0;
+  }
+  // Redondeado hacia arriba: llegar antes del plazo no sirve de nada
+  return Timing_CyclesToUs(xfer.deadline - Timing_Cycles()) / 1000 + 1;
+}
+
+uint32_t MFRC522_IrqLost(void) { return irqLost; }
+
+static void MFRC522_Finish(uint8_t irq) {
+  uint8_t n;
+  uint8_t lastBits;
+
+  MFRC522_ClearBitMask(MFRC522_REG_BIT_FRAMING, 0x80); // StopSend
+
+  if (!(irq & 0x01) && !(irq & xfer.waitIRq)) {
+    return; // Timeout: status queda en MI_ERR
+  }
+
+  // BufferOvfl, ParityErr, ProtocolErr. Una colisión (CollErr) no invalida
+  // los bits recibidos antes de ella: se leen igual para la anticolisión.
+  uint8_t err = MFRC522_ReadRegister(MFRC522_REG_ERROR);
+  if (err & 0x13) {
+    xfer.status = MI_ERR;
+    return;
+  }
+
+  xfer.status = (err & 0x08) ? MI_COLLERR : MI_OK;
+  if (irq & xfer.irqEn & 0x01) {
+    xfer.status = MI_NOTAGERR;
+  }
+
+  if (xfer.command == PCD_TRANSCEIVE) {
+    n = MFRC522_ReadRegister(MFRC522_REG_FIFO_LEVEL);
+    lastBits = MFRC522_ReadRegister(MFRC522_REG_CONTROL) & 0x07;
+    if (lastBits) {
+      xfer.backLen = (n - 1) * 8 + lastBits;
     } else {
-      status = MI_ERR;
+      xfer.backLen = n * 8;
     }
+
+    if (n == 0)
+      n = 1;
+    if (n > 16)
+      n = 16;
+
+    MFRC522_ReadFIFO(xfer.backData, n);
+  }
+}
+
+// Versión bloqueante: misma transferencia, esperando aquí el final
+static void MFRC522_Wait(void) {
+  while (xfer.busy) {
+    MFRC522_Poll();
   }
+}
 
-  return status;
+uint8_t MFRC522_ToCard(uint8_t command, uint8_t *sendData, uint8_t sendLen,
+                       uint8_t *backData, uint16_t *backLen) {
+  if (MFRC522_ToCardAsync(command, sendData, sendLen, backData, NULL) !=
+      MI_OK) {
+    return MI_ERR;
+  }
+  MFRC522_Wait();
+  *backLen = xfer.backLen;
+  return xfer.status;
 }
 
-uint8_t MFRC522_Request(uint8_t reqMode, uint8_t *TagType) {
-  uint8_t status;
-  uint16_t backBits;
+uint8_t MFRC522_RequestAsync(uint8_t reqMode, uint8_t *TagType,
+                             MFRC522_Callback_t callback) {
+  if (xfer.busy) {
+    return MI_ERR;
+  }
 
   MFRC522_WriteRegister(MFRC522_REG_BIT_FRAMING, 0x07); // TxLastBists
   TagType[0] = reqMode;
-  status = MFRC522_ToCard(PCD_TRANSCEIVE, TagType, 1, TagType, &backBits);
+  MFRC522_ToCardAsync(PCD_TRANSCEIVE, TagType, 1, TagType, callback);
+  xfer.check = MFRC522_CheckRequest;
+  return MI_OK;
+}
+
+uint8_t MFRC522_Request(uint8_t reqMode, uint8_t *TagType) {
+  if (MFRC522_RequestAsync(reqMode, TagType, NULL) != MI_OK) {
+    return MI_ERR;
+  }
+  MFRC522_Wait();
+  return xfer.status;
+}
 
-  if ((status != MI_OK) || (backBits != 0x10)) {
+static uint8_t MFRC522_CheckRequest(uint8_t status) {
+  // Con varias tarjetas el ATQA puede llegar con colisión: igual hay tarjeta
+  if (status == MI_COLLERR) {
+    status = MI_OK;
+  }
+  if ((status != MI_OK) || (xfer.backLen != 0x10)) {
     status = MI_ERR;
   }
   return status;
 }
 
-uint8_t MFRC522_Anticoll(uint8_t *serNum) {
-  uint8_t status;
-  uint8_t i;
-  uint8_t serNumCheck = 0;
-  uint16_t unLen;
+uint8_t MFRC522_AnticollAsync(uint8_t *serNum, MFRC522_Callback_t callback) {
+  if (xfer.busy) {
+    return MI_ERR;
+  }
 
   MFRC522_WriteRegister(MFRC522_REG_BIT_FRAMING, 0x00);
 
   serNum[0] = PICC_ANTICOLL;
   serNum[1] = 0x20;
-  status = MFRC522_ToCard(PCD_TRANSCEIVE, serNum, 2, serNum, &unLen);
+  MFRC522_ToCardAsync(PCD_TRANSCEIVE, serNum, 2, serNum, callback);
+  xfer.check = MFRC522_CheckAnticoll;
+  return MI_OK;
+}
+
+uint8_t MFRC522_Anticoll(uint8_t *serNum) {
+  if (MFRC522_AnticollAsync(serNum, NULL) != MI_OK) {
+    return MI_ERR;
+  }
+  MFRC522_Wait();
+  return xfer.status;
+}
+
+static uint8_t MFRC522_CheckAnticoll(uint8_t status) {
+  uint8_t i;
+  uint8_t serNumCheck = 0;
 
   if (status == MI_OK) {
     for (i = 0; i < 4; i++) {
-      serNumCheck ^= serNum[i];
+      serNumCheck ^= xfer.backData[i];
     }
-    if (serNumCheck != serNum[4]) {
+    if (serNumCheck != xfer.backData[4]) {
       status = MI_ERR;
     }
   }
   return status;
 }
+
+// --- CRC_A con el coprocesador del chip ---
+// Preset 0x6363 (ModeReg). Bloquea unos pocos microsegundos; solo se usa
+// entre transferencias, cuando COMMAND y el FIFO están libres.
+static bool MFRC522_CalculateCRC(const uint8_t *data, uint8_t len,
+                                 uint8_t *result) {
+  MFRC522_WriteRegister(MFRC522_REG_COMMAND, PCD_IDLE);
+  MFRC522_WriteRegister(MFRC522_REG_DIV_IRQ, 0x04);    // Borra CRCIRq
+  MFRC522_WriteRegister(MFRC522_REG_FIFO_LEVEL, 0x80); // FlushBuffer
+  MFRC522_WriteFIFO(data, len);
+  MFRC522_WriteRegister(MFRC522_REG_COMMAND, PCD_CALCCRC);
+
+  uint32_t deadline = Timing_DeadlineUs(MFRC522_CRC_TIMEOUT_US);
+  do {
+    if (MFRC522_ReadRegister(MFRC522_REG_DIV_IRQ) & 0x04) { // CRCIRq
+      MFRC522_WriteRegister(MFRC522_REG_COMMAND, PCD_IDLE);
+      result[0] = MFRC522_ReadRegister(MFRC522_REG_CRC_RESULT_L);
+      result[1] = MFRC522_ReadRegister(MFRC522_REG_CRC_RESULT_M);
+      return true;
+    }
+  } while (!Timing_Expired(deadline));
+
+  MFRC522_WriteRegister(MFRC522_REG_COMMAND, PCD_IDLE);
+  return false;
+}
+
+// --- SELECT en cascada (CL1-CL3) ---
+// Por cada nivel: ANTICOLL orientado a bit hasta conocer los 32 bits del
+// nivel, y SELECT con CRC_A. Ante una colisión se toma la rama del 1 en la
+// posición que indica CollReg y se repite el ANTICOLL con esos bits ya
+// conocidos. El SAK indica si el UID sigue en el nivel siguiente.
+
+static struct {
+  volatile bool busy;
+  uint8_t level; // 0..2 -> CL1..CL3
+  uint8_t known; // Bits del UID del nivel ya conocidos (0..32)
+  uint8_t status;
+  uint8_t frame[9]; // SEL, NVB, 4 bytes de UID, BCC, CRC_A
+  uint8_t rx[16];   // MFRC522_Finish lee hasta 16 bytes
+  MFRC522_Uid_t *uid;
+  const MFRC522_Uid_t *target; // UID ya conocido (sin anticolisión) o NULL
+  MFRC522_UidCallback_t callback;
+} sel;
+
+static const uint8_t SEL_CODES[3] = {PICC_SEL_CL1, PICC_SEL_CL2, PICC_SEL_CL3};
+
+static void MFRC522_SelectOnAnticoll(uint8_t status, uint8_t *backData,
+                                     uint16_t backBits);
+static void MFRC522_SelectOnSak(uint8_t status, uint8_t *backData,
+                                uint16_t backBits);
+
+static void MFRC522_SelectDone(uint8_t status) {
+  sel.status = status;
+  sel.busy = false;
+  if (sel.callback != NULL) {
+    sel.callback(status, sel.uid);
+  }
+}
+
+// ANTICOLL con los 'known' primeros bits del nivel: la tarjeta responde
+// desde el bit siguiente, alineado en el mismo byte (RxAlign = TxLastBits)
+static void MFRC522_AnticollStep(void) {
+  uint8_t bytes = sel.known / 8;
+  uint8_t bits = sel.known % 8;
+
+  sel.frame[0] = SEL_CODES[sel.level];
+  sel.frame[1] = ((2 + bytes) << 4) | bits; // NVB
+  MFRC522_WriteRegister(MFRC522_REG_BIT_FRAMING, (bits << 4) | bits);
+  MFRC522_ToCardAsync(PCD_TRANSCEIVE, sel.frame, 2 + bytes + (bits ? 1 : 0),
+                      sel.rx, MFRC522_SelectOnAnticoll);
+}
+
+// SELECT: SEL, NVB=0x70 (7 bytes completos), UID del nivel, BCC, CRC_A
+static void MFRC522_SelectSend(void) {
+  sel.frame[0] = SEL_CODES[sel.level];
+  sel.frame[1] = 0x70;
+  if (!MFRC522_CalculateCRC(sel.frame, 7, &sel.frame[7])) {
+    MFRC522_SelectDone(MI_ERR);
+    return;
+  }
+
+  MFRC522_WriteRegister(MFRC522_REG_BIT_FRAMING, 0x00);
+  MFRC522_ToCardAsync(PCD_TRANSCEIVE, sel.frame, 9, sel.rx,
+                      MFRC522_SelectOnSak);
+}
+
+// Nivel tomado del UID conocido: 3 bytes por nivel tras el Cascade Tag, 4 en
+// el último (4 bytes: 1 nivel, 7: 2, 10: 3)
+static void MFRC522_SelectTargetLevel(void) {
+  const uint8_t *bytes = &sel.target->bytes[3 * sel.level];
+
+  if (sel.level + 1 < sel.target->size / 3) {
+    sel.frame[2] = PICC_CASCADE_TAG;
+    memcpy(&sel.frame[3], bytes, 3);
+  } else {
+    memcpy(&sel.frame[2], bytes, 4);
+  }
+  sel.frame[6] = sel.frame[2] ^ sel.frame[3] ^ sel.frame[4] ^ sel.frame[5];
+  sel.known = 32;
+  MFRC522_SelectSend();
+}
+
+static uint8_t MFRC522_SelectStart(const MFRC522_Uid_t *target,
+                                   MFRC522_Uid_t *uid,
+                                   MFRC522_UidCallback_t callback) {
+  if (xfer.busy || sel.busy) {
+    return MI_ERR;
+  }
+
+  memset(uid, 0, sizeof(*uid));
+  sel.uid = uid;
+  sel.target = target;
+  sel.callback = callback;
+  sel.level = 0;
+  sel.known = 0;
+  sel.status = MI_ERR;
+  sel.busy = true;
+  memset(sel.frame, 0, sizeof(sel.frame));
+
+  if (target != NULL) {
+    MFRC522_SelectTargetLevel();
+    return MI_OK;
+  }
+  // ValuesAfterColl=0: los bits recibidos tras una colisión se leen en 0
+  MFRC522_ClearBitMask(MFRC522_REG_COLL, 0x80);
+  MFRC522_AnticollStep();
+  return MI_OK;
+}
+
+uint8_t MFRC522_SelectAsync(MFRC522_Uid_t *uid, MFRC522_UidCallback_t callback) {
+  return MFRC522_SelectStart(NULL, uid, callback);
+}
+
+uint8_t MFRC522_Select(MFRC522_Uid_t *uid) {
+  if (MFRC522_SelectAsync(uid, NULL) != MI_OK) {
+    return MI_ERR;
+  }
+  while (sel.busy) {
+    MFRC522_Poll();
+  }
+  return sel.status;
+}
+
+static void MFRC522_SelectOnAnticoll(uint8_t status, uint8_t *backData,
+                                     uint16_t backBits) {
+  uint8_t first = 2 + sel.known / 8; // Byte de frame donde empieza la respuesta
+  uint8_t keep = (1 << (sel.known % 8)) - 1; // Bits de ese byte ya enviados
+
+  if ((status != MI_OK && status != MI_COLLERR) || backBits == 0) {
+    MFRC522_SelectDone(MI_ERR);
+    return;
+  }
+
+  // Completar UID + BCC con lo recibido
+  for (uint8_t i = 0; first + i < 7 && i * 8 < backBits; i++) {
+    uint8_t mask = (i == 0) ? keep : 0;
+    sel.frame[first + i] = (sel.frame[first + i] & mask) | (backData[i] & ~mask);
+  }
+
+  if (status == MI_COLLERR) {
+    uint8_t coll = MFRC522_ReadRegister(MFRC522_REG_COLL);
+    uint8_t pos = coll & 0x1F; // 1..31, 0 = bit 32
+
+    if (coll & 0x20) { // CollPosNotValid
+      MFRC522_SelectDone(MI_ERR);
+      return;
+    }
+    if (pos == 0) {
+      pos = 32;
+    }
+    if (pos <= sel.known) {
+      MFRC522_SelectDone(MI_ERR); // Sin avance: no converge
+      return;
+    }
+    // Quedarse con las tarjetas que tienen un 1 en el bit en conflicto
+    sel.frame[2 + (pos - 1) / 8] |= 1 << ((pos - 1) % 8);
+    sel.known = pos;
+    MFRC522_AnticollStep();
+    return;
+  }
+
+  // 32 bits del nivel y BCC completos
+  if ((sel.frame[2] ^ sel.frame[3] ^ sel.frame[4] ^ sel.frame[5]) !=
+      sel.frame[6]) {
+    MFRC522_SelectDone(MI_ERR);
+    return;
+  }
+  sel.known = 32;
+  MFRC522_SelectSend();
+}
+
+static void MFRC522_SelectOnSak(uint8_t status, uint8_t *backData,
+                                uint16_t backBits) {
+  uint8_t crc[2];
+
+  // SAK + CRC_A
+  if (status != MI_OK || backBits != 24 ||
+      !MFRC522_CalculateCRC(backData, 1, crc) || crc[0] != backData[1] ||
+      crc[1] != backData[2]) {
+    MFRC522_SelectDone(MI_ERR);
+    return;
+  }
+
+  MFRC522_Uid_t *uid = sel.uid;
+  uint8_t sak = backData[0];
+
+  if (sak & PICC_SAK_CASCADE) {
+    // UID incompleto: el primer byte del nivel es el Cascade Tag
+    if (sel.frame[2] != PICC_CASCADE_TAG || sel.level >= 2) {
+      MFRC522_SelectDone(MI_ERR);
+      return;
+    }
+    memcpy(&uid->bytes[uid->size], &sel.frame[3], 3);
+    uid->size += 3;
+    sel.level++;
+    sel.known = 0;
+    memset(sel.frame, 0, sizeof(sel.frame));
+    if (sel.target != NULL) {
+      MFRC522_SelectTargetLevel();
+    } else {
+      MFRC522_AnticollStep();
+    }
+    return;
+  }
+
+  memcpy(&uid->bytes[uid->size], &sel.frame[2], 4);
+  uid->size += 4;
+  uid->sak = sak;
+  MFRC522_SelectDone(MI_OK);
+}
+
+// --- HALT ---
+// HLTA + CRC_A. La tarjeta no responde: basta con que la trama salga.
+uint8_t MFRC522_HaltAsync(MFRC522_Callback_t callback) {
+  uint8_t frame[4] = {PICC_HALT, 0x00};
+
+  if (xfer.busy || !MFRC522_CalculateCRC(frame, 2, &frame[2])) {
+    return MI_ERR;
+  }
+
+  MFRC522_WriteRegister(MFRC522_REG_BIT_FRAMING, 0x00);
+  // WriteFIFO copia la trama antes de retornar: 'frame' puede ser local
+  MFRC522_ToCardAsync(PCD_TRANSMIT, frame, 4, NULL, callback);
+  return MI_OK;
+}
+
+uint8_t MFRC522_Halt(void) {
+  if (MFRC522_HaltAsync(NULL) != MI_OK) {
+    return MI_ERR;
+  }
+  MFRC522_Wait();
+  return xfer.status;
+}
+
+// --- Inventario ---
+// REQA -> SELECT -> HALT hasta que ninguna tarjeta responda al REQA: las
+// seleccionadas quedan en HALT y dejan de contestar, así cada vuelta
+// resuelve una tarjeta nueva. Con PICC_REQALL la primera petición es un
+// WUPA, que despierta también a las que estaban en HALT, pero esas (READY*)
+// vuelven a HALT con el SELECT de otra tarjeta y no contestan al REQA
+// siguiente: para confirmar tarjetas conocidas está MFRC522_ConfirmAsync.
+
+static struct {
+  volatile bool busy;
+  uint8_t count;
+  uint8_t max;
+  uint8_t atqa[16]; // MFRC522_Finish lee hasta 16 bytes
+  MFRC522_Uid_t *uids;
+  MFRC522_InventoryCallback_t callback;
+} inv;
+
+static void MFRC522_InventoryOnRequest(uint8_t status, uint8_t *backData,
+                                       uint16_t backBits);
+static void MFRC522_InventoryOnSelect(uint8_t status, const MFRC522_Uid_t *uid);
+static void MFRC522_InventoryOnHalt(uint8_t status, uint8_t *backData,
+                                    uint16_t backBits);
+
+static void MFRC522_InventoryDone(void) {
+  inv.busy = false;
+  if (inv.callback != NULL) {
+    inv.callback(inv.count, inv.uids);
+  }
+}
+
+uint8_t MFRC522_InventoryAsync(MFRC522_Uid_t *uids, uint8_t max,
+                               uint8_t reqMode,
+                               MFRC522_InventoryCallback_t callback) {
+  if (MFRC522_IsBusy() || max == 0) {
+    return MI_ERR;
+  }
+
+  inv.uids = uids;
+  inv.max = max;
+  inv.count = 0;
+  inv.callback = callback;
+  inv.busy = true;
+  MFRC522_RequestAsync(reqMode, inv.atqa, MFRC522_InventoryOnRequest);
+  return MI_OK;
+}
+
+uint8_t MFRC522_Inventory(MFRC522_Uid_t *uids, uint8_t max, uint8_t reqMode) {
+  if (MFRC522_InventoryAsync(uids, max, reqMode, NULL) != MI_OK) {
+    return 0;
+  }
+  while (inv.busy) {
+    MFRC522_Poll();
+  }
+  return inv.count;
+}
+
+static void MFRC522_InventoryOnRequest(uint8_t status, uint8_t *backData,
+                                       uint16_t backBits) {
+  (void)backData;
+  (void)backBits;
+
+  if (status != MI_OK) {
+    MFRC522_InventoryDone(); // Ninguna tarjeta más en el campo
+    return;
+  }
+  MFRC522_SelectAsync(&inv.uids[inv.count], MFRC522_InventoryOnSelect);
+}
+
+static void MFRC522_InventoryOnSelect(uint8_t status, const MFRC522_Uid_t *uid) {
+  (void)uid;
+
+  // Un SELECT fallido (ruido, tarjeta retirada) termina con lo leído
+  if (status != MI_OK) {
+    MFRC522_InventoryDone();
+    return;
+  }
+  inv.count++;
+  if (MFRC522_HaltAsync(MFRC522_InventoryOnHalt) != MI_OK) {
+    MFRC522_InventoryDone();
+  }
+}
+
+static void MFRC522_InventoryOnHalt(uint8_t status, uint8_t *backData,
+                                    uint16_t backBits) {
+  (void)status;
+  (void)backData;
+  (void)backBits;
+
+  if (inv.count >= inv.max) {
+    MFRC522_InventoryDone();
+    return;
+  }
+  MFRC522_RequestAsync(PICC_REQIDL, inv.atqa, MFRC522_InventoryOnRequest);
+}
+
+// --- Confirmación ---
+// WUPA -> SELECT con el UID conocido -> HALT. El WUPA despierta a todas las
+// tarjetas en HALT, pero solo la del UID contesta al SELECT; las demás
+// vuelven a HALT, así cada tarjeta se confirma aunque haya varias.
+
+static struct {
+  volatile bool busy;
+  uint8_t status;
+  uint8_t atqa[16]; // MFRC522_Finish lee hasta 16 bytes
+  const MFRC522_Uid_t *target;
+  MFRC522_Uid_t uid;
+  MFRC522_UidCallback_t callback;
+} conf;
+
+static void MFRC522_ConfirmOnRequest(uint8_t status, uint8_t *backData,
+                                     uint16_t backBits);
+static void MFRC522_ConfirmOnSelect(uint8_t status, const MFRC522_Uid_t *uid);
+static void MFRC522_ConfirmOnHalt(uint8_t status, uint8_t *backData,
+                                  uint16_t backBits);
+
+static void MFRC522_ConfirmDone(uint8_t status) {
+  conf.status = status;
+  conf.busy = false;
+  if (conf.callback != NULL) {
+    conf.callback(status, conf.target);
+  }
+}
+
+uint8_t MFRC522_ConfirmAsync(const MFRC522_Uid_t *uid,
+                             MFRC522_UidCallback_t callback) {
+  if (MFRC522_IsBusy()) {
+    return MI_ERR;
+  }
+
+  conf.target = uid;
+  conf.callback = callback;
+  conf.status = MI_ERR;
+  conf.busy = true;
+  MFRC522_RequestAsync(PICC_REQALL, conf.atqa, MFRC522_ConfirmOnRequest);
+  return MI_OK;
+}
+
+uint8_t MFRC522_Confirm(const MFRC522_Uid_t *uid) {
+  if (MFRC522_ConfirmAsync(uid, NULL) != MI_OK) {
+    return MI_ERR;
+  }
+  while (conf.busy) {
+    MFRC522_Poll();
+  }
+  return conf.status;
+}
+
+static void MFRC522_ConfirmOnRequest(uint8_t status, uint8_t *backData,
+                                     uint16_t backBits) {
+  (void)backData;
+  (void)backBits;
+
+  // Sin ATQA no hay ninguna tarjeta en el campo
+  if (status != MI_OK ||
+      MFRC522_SelectStart(conf.target, &conf.uid, MFRC522_ConfirmOnSelect) !=
+          MI_OK) {
+    MFRC522_ConfirmDone(MI_ERR);
+  }
+}
+
+static void MFRC522_ConfirmOnSelect(uint8_t status, const MFRC522_Uid_t *uid) {
+  (void)uid;
+
+  if (status != MI_OK) {
+    MFRC522_ConfirmDone(MI_ERR); // No está (o no contestó esta vez)
+    return;
+  }
+  if (MFRC522_HaltAsync(MFRC522_ConfirmOnHalt) != MI_OK) {
+    MFRC522_ConfirmDone(MI_OK);
+  }
+}
+
+static void MFRC522_ConfirmOnHalt(uint8_t status, uint8_t *backData,
+                                  uint16_t backBits) {
+  (void)status;
+  (void)backData;
+  (void)backBits;
+
+  MFRC522_ConfirmDone(MI_OK);
+}
+
+// Ocupado mientras haya una transferencia o una secuencia en curso
+bool MFRC522_IsBusy(void) {
+  return xfer.busy || sel.busy || inv.busy || conf.busy;
+}
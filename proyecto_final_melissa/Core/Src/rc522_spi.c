@@ -0,0 +1,181 @@
+/*
+ * rc522_spi.c
+ * Cola de transferencias SPI por DMA para el MFRC522.
+ *
+ * El lazo principal escribe en 'head'; la interrupción de fin de DMA sube
+ * NSS, llama al callback, avanza 'tail' y arranca la siguiente transferencia.
+ */
+
+#include "rc522_spi.h"
+#include <string.h>
+
+static SPI_HandleTypeDef *spi;
+static GPIO_TypeDef *nssPort;
+static uint16_t nssPin;
+
+static RC522_SPI_Xfer_t queue[RC522_SPI_QUEUE_LEN];
+static volatile uint8_t head = 0;
+static volatile uint8_t tail = 0;
+static volatile bool active = false; // DMA en curso para queue[tail]
+static volatile bool busError = false;
+
+static void RC522_SPI_Start(void);
+static void RC522_SPI_Complete(bool ok);
+static void RC522_SPI_Done(bool ok, void *ctx);
+
+void RC522_SPI_Init(SPI_HandleTypeDef *hspi, GPIO_TypeDef *csPort,
+                    uint16_t csPin) {
+  spi = hspi;
+  nssPort = csPort;
+  nssPin = csPin;
+  head = 0;
+  tail = 0;
+  active = false;
+}
+
+void RC522_SPI_Submit(const uint8_t *tx, uint8_t *rx, uint16_t len,
+                      RC522_SPI_Callback_t callback, void *ctx) {
+  // Sin DMA: transferencia bloqueante en el momento
+  if (spi->hdmatx == NULL || spi->hdmarx == NULL) {
+    HAL_StatusTypeDef st;
+    HAL_GPIO_WritePin(nssPort, nssPin, GPIO_PIN_RESET); // Select
+    if (rx != NULL) {
+      st = HAL_SPI_TransmitReceive(spi, (uint8_t *)tx, rx, len, 500);
+    } else {
+      st = HAL_SPI_Transmit(spi, (uint8_t *)tx, len, 500);
+    }
+    HAL_GPIO_WritePin(nssPort, nssPin, GPIO_PIN_SET); // Deselect
+    if (st != HAL_OK) {
+      busError = true;
+    }
+    if (callback != NULL) {
+      callback(st == HAL_OK, ctx);
+    }
+    return;
+  }
+
+  uint8_t next = (head + 1) & (RC522_SPI_QUEUE_LEN - 1);
+  while (next == tail) {
+    // Cola llena: el DMA la va vaciando
+  }
+
+  RC522_SPI_Xfer_t *xfer = &queue[head];
+  if (tx != NULL && len <= RC522_SPI_INLINE_LEN && rx == NULL) {
+    memcpy(xfer->data, tx, len);
+    tx = xfer->data;
+  }
+  xfer->tx = tx;
+  xfer->rx = rx;
+  xfer->len = len;
+  xfer->callback = callback;
+  xfer->ctx = ctx;
+  head = next;
+
+  RC522_SPI_Start();
+}
+
+void RC522_SPI_Write(const uint8_t *tx, uint16_t len) {
+  if (len <= RC522_SPI_INLINE_LEN) {
+    RC522_SPI_Submit(tx, NULL, len, NULL, NULL);
+  } else {
+    RC522_SPI_Transfer(tx, NULL, len); // Buffer del llamador: hay que esperar
+  }
+}
+
+// Estado de una transferencia bloqueante (en la pila del llamador)
+typedef struct {
+  volatile bool done;
+  volatile bool ok;
+} RC522_SPI_Wait_t;
+
+static void RC522_SPI_Done(bool ok, void *ctx) {
+  RC522_SPI_Wait_t *wait = ctx;
+  wait->ok = ok;
+  wait->done = true;
+}
+
+bool RC522_SPI_Transfer(const uint8_t *tx, uint8_t *rx, uint16_t len) {
+  RC522_SPI_Wait_t wait = {false, false};
+
+  RC522_SPI_Submit(tx, rx, len, RC522_SPI_Done, &wait);
+  while (!wait.done) {
+    // La CPU solo espera el resultado; el bus lo mueve el DMA
+  }
+  return wait.ok;
+}
+
+void RC522_SPI_Flush(void) {
+  while (head != tail) {
+  }
+}
+
+bool RC522_SPI_SetPrescaler(uint32_t prescaler) {
+  RC522_SPI_Flush();
+  spi->Init.BaudRatePrescaler = prescaler;
+  // El periférico ya está inicializado: no vuelve a pasar por el MSP
+  return HAL_SPI_Init(spi) == HAL_OK;
+}
+
+uint32_t RC522_SPI_GetPrescaler(void) { return spi->Init.BaudRatePrescaler; }
+
+bool RC522_SPI_TakeError(void) {
+  bool err = busError;
+  busError = false;
+  return err;
+}
+
+// Arranca queue[tail] si el DMA está libre (lazo principal o interrupción)
+static void RC522_SPI_Start(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  // Si el DMA no arranca, la transferencia falla y se intenta la siguiente
+  while (!active && head != tail) {
+    RC522_SPI_Xfer_t *xfer = &queue[tail];
+    HAL_StatusTypeDef st;
+
+    active = true;
+    HAL_GPIO_WritePin(nssPort, nssPin, GPIO_PIN_RESET); // Select
+    if (xfer->rx != NULL) {
+      st = HAL_SPI_TransmitReceive_DMA(spi, (uint8_t *)xfer->tx, xfer->rx,
+                                       xfer->len);
+    } else {
+      st = HAL_SPI_Transmit_DMA(spi, (uint8_t *)xfer->tx, xfer->len);
+    }
+    if (st != HAL_OK) {
+      RC522_SPI_Complete(false);
+    }
+  }
+
+  __set_PRIMASK(primask);
+}
+
+static void RC522_SPI_Complete(bool ok) {
+  RC522_SPI_Xfer_t *xfer = &queue[tail];
+
+  if (!ok) {
+    busError = true;
+  }
+  HAL_GPIO_WritePin(nssPort, nssPin, GPIO_PIN_SET); // Deselect
+  if (xfer->callback != NULL) {
+    xfer->callback(ok, xfer->ctx);
+  }
+  tail = (tail + 1) & (RC522_SPI_QUEUE_LEN - 1);
+  active = false;
+}
+
+void RC522_SPI_CpltCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi != spi || !active) {
+    return;
+  }
+  RC522_SPI_Complete(true);
+  RC522_SPI_Start();
+}
+
+void RC522_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi != spi || !active) {
+    return;
+  }
+  RC522_SPI_Complete(false);
+  RC522_SPI_Start();
+}
@@ -0,0 +1,214 @@
+/*
+ * rfid.c
+ * Planificador de sondeo del lector RFID y seguimiento de presencia.
+ * Entre sondeos no hay tráfico SPI; sin tarjetas presentes tampoco hay
+ * campo RF.
+ */
+
+#include "rfid.h"
+#include "rc522_spi.h"
+#include <string.h>
+
+typedef enum {
+  RFID_OFF,      // Antena apagada, esperando el próximo sondeo
+  RFID_SETTLING, // Antena encendida, esperando a que la tarjeta arranque
+  RFID_ON,       // Antena encendida con tarjetas en HALT, esperando
+  RFID_POLLING   // Confirmación de las recordadas e inventario en curso
+} RFID_Phase_t;
+
+static RFID_Callback_t onCards;
+static RFID_Phase_t phase = RFID_OFF;
+static uint32_t phaseStart = 0;   // HAL_GetTick al entrar en la fase
+static uint32_t lastActivity = 0; // HAL_GetTick de la última actividad
+static bool accepting = false;
+
+static MFRC522_Uid_t seen[RFID_MAX_CARDS]; // Inventario en curso
+static MFRC522_Uid_t fresh[RFID_MAX_CARDS]; // Nuevas a informar
+
+// Tarjetas presentes (en HALT), última vez que se vieron y si ya se
+// informaron (las leídas sin aceptar esperan a que se acepte)
+static MFRC522_Uid_t present[RFID_MAX_CARDS];
+static uint32_t presentTime[RFID_MAX_CARDS];
+static bool presentReported[RFID_MAX_CARDS];
+static uint8_t presentCount = 0;
+static uint8_t confirmIndex = 0; // Próxima recordada a confirmar
+
+static void RFID_ConfirmNext(void);
+static void RFID_OnConfirm(uint8_t status, const MFRC522_Uid_t *uid);
+static void RFID_OnInventory(uint8_t count, const MFRC522_Uid_t *uids);
+
+void RFID_Init(RFID_Callback_t callback) {
+  onCards = callback;
+  MFRC522_AntennaOff();
+  phase = RFID_OFF;
+  presentCount = 0;
+  lastActivity = HAL_GetTick();
+  phaseStart = lastActivity - RFID_POLL_SLOW_MS; // Primer sondeo inmediato
+}
+
+void RFID_Activity(void) { lastActivity = HAL_GetTick(); }
+
+// Intervalo entre sondeos según la actividad reciente
+static uint32_t RFID_Interval(uint32_t now) {
+  if (phase == RFID_ON || now - lastActivity < RFID_ACTIVE_WINDOW_MS) {
+    return RFID_POLL_FAST_MS;
+  }
+  return RFID_POLL_SLOW_MS;
+}
+
+static void RFID_AntennaOff(uint32_t now) {
+  MFRC522_AntennaOff();
+  phase = RFID_OFF;
+  phaseStart = now;
+}
+
+// ms que faltan para que la fase actual termine de esperar 'wait'
+static uint32_t RFID_Remaining(uint32_t now, uint32_t wait) {
+  uint32_t elapsed = now - phaseStart;
+  return elapsed < wait ? wait - elapsed : 0;
+}
+
+uint32_t RFID_Run(bool accept) {
+  uint32_t now = HAL_GetTick();
+
+  // Avanza la transferencia en curso; los resultados llegan por callback
+  MFRC522_Poll();
+  if (MFRC522_IsBusy()) {
+    return MFRC522_PollDelay();
+  }
+
+  // Tras un error de bus, volver a probar el enlace (puede bajar la velocidad)
+  if (RC522_SPI_TakeError()) {
+    MFRC522_AutoTune();
+  }
+
+  accepting = accept;
+  if (!accept && presentCount == 0) {
+    if (phase != RFID_OFF) {
+      RFID_AntennaOff(now);
+    }
+    return RFID_POLL_SLOW_MS; // Nada que hacer hasta que vuelva 'accept'
+  }
+
+  switch (phase) {
+  case RFID_OFF: {
+    uint32_t wait = RFID_Remaining(now, RFID_Interval(now));
+    if (wait != 0) {
+      return wait;
+    }
+    MFRC522_AntennaOn();
+    phase = RFID_SETTLING;
+    phaseStart = now;
+    return RFID_FIELD_SETTLE_MS;
+  }
+
+  case RFID_SETTLING:
+  case RFID_ON: {
+    uint32_t wait = RFID_Remaining(
+        now, phase == RFID_SETTLING ? RFID_FIELD_SETTLE_MS : RFID_Interval(now));
+    if (wait != 0) {
+      return wait;
+    }
+    phase = RFID_POLLING;
+    confirmIndex = 0;
+    RFID_ConfirmNext();
+    return MFRC522_PollDelay();
+  }
+
+  default:
+    return MFRC522_PollDelay();
+  }
+}
+
+// Cada recordada se confirma por su UID (un WUPA solo no alcanza: con varias
+// en HALT, el SELECT de una devuelve al resto a HALT); después, un REQA
+// busca las nuevas, que son las únicas fuera de HALT
+static void RFID_ConfirmNext(void) {
+  if (confirmIndex < presentCount &&
+      MFRC522_ConfirmAsync(&present[confirmIndex], RFID_OnConfirm) == MI_OK) {
+    return;
+  }
+  MFRC522_InventoryAsync(seen, RFID_MAX_CARDS, PICC_REQIDL, RFID_OnInventory);
+}
+
+static void RFID_OnConfirm(uint8_t status, const MFRC522_Uid_t *uid) {
+  (void)uid;
+
+  if (status == MI_OK) {
+    presentTime[confirmIndex] = HAL_GetTick();
+  }
+  confirmIndex++;
+  RFID_ConfirmNext();
+}
+
+static bool RFID_SameUid(const MFRC522_Uid_t *a, const MFRC522_Uid_t *b) {
+  return a->size == b->size && memcmp(a->bytes, b->bytes, a->size) == 0;
+}
+
+static bool RFID_Contains(const MFRC522_Uid_t *list, uint8_t count,
+                          const MFRC522_Uid_t *uid) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (RFID_SameUid(&list[i], uid)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void RFID_OnInventory(uint8_t count, const MFRC522_Uid_t *uids) {
+  uint32_t now = HAL_GetTick();
+  uint8_t freshCount = 0;
+  uint8_t kept = 0;
+
+  // 1. Las recordadas que se confirmaron (o que volvieron a contestar al
+  // REQA, por ejemplo tras salir de HALT) siguen presentes; las que llevan
+  // RFID_ABSENT_MS sin responder se dan por retiradas
+  for (uint8_t i = 0; i < presentCount; i++) {
+    if (RFID_Contains(uids, count, &present[i])) {
+      presentTime[i] = now;
+    } else if (now - presentTime[i] > RFID_ABSENT_MS) {
+      lastActivity = now; // Retirada: sondeo rápido para la siguiente
+      continue;
+    }
+    present[kept] = present[i];
+    presentTime[kept] = presentTime[i];
+    presentReported[kept] = presentReported[i];
+    kept++;
+  }
+  presentCount = kept;
+
+  // 2. Las nuevas se recuerdan; quedan en HALT y se confirman como el resto
+  for (uint8_t i = 0; i < count; i++) {
+    if (RFID_Contains(present, presentCount, &uids[i]) ||
+        presentCount >= RFID_MAX_CARDS) {
+      continue;
+    }
+    present[presentCount] = uids[i];
+    presentTime[presentCount] = now;
+    presentReported[presentCount] = false;
+    presentCount++;
+  }
+
+  // 3. Se informan las que aún no se informaron, solo si se aceptan ahora
+  for (uint8_t i = 0; i < presentCount && accepting; i++) {
+    if (!presentReported[i]) {
+      presentReported[i] = true;
+      fresh[freshCount++] = present[i];
+    }
+  }
+
+  // 4. Con tarjetas en HALT la antena sigue encendida (apagarla las reinicia)
+  if (presentCount > 0) {
+    phase = RFID_ON;
+    phaseStart = now;
+  } else {
+    RFID_AntennaOff(now);
+  }
+
+  if (freshCount > 0) {
+    lastActivity = now;
+    if (onCards != NULL) {
+      onCards(freshCount, fresh);
+    }
+  }
+}
@@ -0,0 +1,53 @@
+#include "scheduler.h"
+#include "timer_wheel.h"
+
+typedef struct {
+  Sched_Pending_t pending;
+  Sched_Handler_t handler;
+} Sched_Source_t;
+
+static Sched_Source_t sources[SCHED_MAX_SOURCES];
+static uint8_t sourceCount = 0;
+
+void Sched_Init(void) { sourceCount = 0; }
+
+bool Sched_AddSource(Sched_Pending_t pending, Sched_Handler_t handler) {
+  if (sourceCount >= SCHED_MAX_SOURCES) {
+    return false;
+  }
+  sources[sourceCount].pending = pending;
+  sources[sourceCount].handler = handler;
+  sourceCount++;
+  return true;
+}
+
+static bool Sched_SourcePending(void) {
+  for (uint8_t i = 0; i < sourceCount; i++) {
+    if (sources[i].pending()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Sched_Dispatch(void) {
+  // 1. Timers moved to the expired list by SysTick since the last pass
+  Timer_RunExpired();
+
+  // 2. Sources with data waiting
+  for (uint8_t i = 0; i < sourceCount; i++) {
+    if (sources[i].pending()) {
+      sources[i].handler(0);
+    }
+  }
+
+  // 3. Nothing left: sleep until an interrupt (SysTick at the latest). The
+  // check runs with interrupts masked so an ISR cannot fill a ring or expire
+  // a timer between the check and WFI; a pending interrupt still wakes the
+  // core.
+  __disable_irq();
+  if (!Timer_HasExpired() && !Sched_SourcePending()) {
+    __WFI();
+  }
+  __enable_irq();
+}
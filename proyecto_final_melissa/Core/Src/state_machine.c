@@ -1,15 +1,33 @@
+#define SM_FSM_TABLES // Generated tables (state_machine_fsm.h) live here
 #include "state_machine.h"
+#include "fsm.h"
 #include "main.h"
 #include "rc522.h"
+#include "ring.h"
+#include "rfid.h"
+#include "scheduler.h"
 #include "stm32f4xx_hal.h"
+#include "timer_wheel.h"
+#include "uart_log.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
 // Configuration
 #define CODE_LENGTH 4
+#define MAX_ATTEMPTS 3 // Wrong codes before BLOCKED
 #define AUTO_CLOSE_DELAY 5000 // ms
-#define MAX_LEN 16
+#define BLOCK_TIME 30000 // ms
+#define INPUT_TIMEOUT 10000 // ms
+#define DENIED_TIME 2000 // ms
+#define SPLASH_TIME 1000 // ms
+#define MESSAGE_TIME 2000 // ms, "No Autorizado"
+#define PWD_CHANGED_TIME 1000 // ms
+#define DOOR_ALERT_TIME 15000 // ms
+#define COUNTDOWN_REFRESH 100 // ms
+#define DOOR_SAMPLE_PERIOD 50 // ms
+#define CARD_INDEX_SLOTS 16 // Power of 2, more than twice the card count
+#define UART_RX_QUEUE_LEN 32 // Received bytes waiting (power of 2)
 
 // Reed Switch Configuration (GPIOB Pin 0)
 // NOTE: Configure this pin as Input with Pull-Up in CubeMX
@@ -17,363 +35,526 @@
 #define REED_SW_PIN GPIO_PIN_0
 
 // State Variables
-static SystemState_t currentState = STATE_IDLE;
+static Fsm_t fsm; // Current state in fsm.state
+// Received bytes from the UART ISR (rx.overflows: bytes lost, queue full)
+RING_DEFINE(SM_RxRing, char, UART_RX_QUEUE_LEN)
+static SM_RxRing_t rx;
 static char currentCode[CODE_LENGTH + 1];
 static uint8_t codeIndex = 0;
 static char savedPassword[CODE_LENGTH + 1] = "1234"; // Contraseña por defecto
-static uint32_t stateEntryTime = 0;
 static uint8_t failedAttempts = 0;
-static uint32_t doorOpenTime = 0; // Timer for door open alert
-static bool alertShown = false;
-static const uint8_t AUTHORIZED_UID[4] = {0xDE, 0xAD, 0xBE,
-                                          0xEF}; // Change as needed
+static bool doorWasOpen = false; // Last reed switch sample
+// Named timers (timer_wheel.c); any transition stops the state ones
+static Timer_t stateTimer;     // Timeout of the current state
+static Timer_t countdownTimer; // BLOCKED countdown redraw
+static Timer_t doorAlertTimer; // Door left open
+static Timer_t cardTimer;      // Next RFID reader step (one-shot)
+static Timer_t doorTimer;      // Reed switch sampling
+static Timer_t keypadTimer;    // Keypad DMA samples
+// Authorized cards (4, 7 or 10-byte UIDs). Change as needed.
+static const MFRC522_Uid_t AUTHORIZED_CARDS[] = {
+    {.size = 4, .bytes = {0xDE, 0xAD, 0xBE, 0xEF}},
+};
+#define AUTHORIZED_COUNT (sizeof(AUTHORIZED_CARDS) / sizeof(AUTHORIZED_CARDS[0]))
+// Open-addressing hash index into AUTHORIZED_CARDS (entry + 1, 0 = empty)
+static uint8_t cardIndex[CARD_INDEX_SLOTS];
+_Static_assert(AUTHORIZED_COUNT * 2 <= CARD_INDEX_SLOTS,
+               "CARD_INDEX_SLOTS too small for AUTHORIZED_CARDS");
+
+// Custom LCD glyphs (5x8), loaded on demand through the CGRAM cache
+static const uint8_t GLYPH_LOCK[8] = {0x0E, 0x11, 0x11, 0x1F,
+                                      0x1B, 0x1B, 0x1F, 0x00};
+static const uint8_t GLYPH_UNLOCK[8] = {0x0E, 0x10, 0x10, 0x1F,
+                                        0x1B, 0x1B, 0x1F, 0x00};
+static const uint8_t GLYPH_KEY[8] = {0x0E, 0x11, 0x0E, 0x04,
+                                     0x06, 0x04, 0x06, 0x00};
+// Progress bar cells with 1 to 4 of the 5 pixel columns filled
+static const uint8_t GLYPH_BAR[4][8] = {
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10},
+    {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+    {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C},
+    {0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E}};
+#define LCD_FULL_BLOCK 0xFF // ROM character with all pixels on
+
+// Static screens, encoded into PCF8574 byte streams at build time
+LCD_SCREEN(SCREEN_SPLASH, "Smart Lock Listo", "Teclas:0-9 A-D", "", "");
+LCD_SCREEN(SCREEN_IDLE, "CERRADO", "", "", "");
+LCD_SCREEN(SCREEN_INPUT_CODE, "Ingrese Codigo: ", "", "", "");
+LCD_SCREEN(SCREEN_GRANTED, "ABIERTO", "", "", "");
+LCD_SCREEN(SCREEN_DENIED, "Acceso Denegado", "", "", "");
+LCD_SCREEN(SCREEN_BLOCKED, "SISTEMA BLOQ.", "Espere 30s...", "", "");
+LCD_SCREEN(SCREEN_PWD_AUTH, "Antigua Clave: ", "", "", "");
+LCD_SCREEN(SCREEN_PWD_NEW, "Nueva Clave: ", "", "", "");
+LCD_SCREEN(SCREEN_PWD_CHANGED, "Cambiada!", "", "", "");
+LCD_SCREEN(SCREEN_UNAUTHORIZED, "No Autorizado", "", "", "");
 
 // Hardware Handles
 static LiquidCrystal_I2C_t *lcdHandle;
 static Keypad_t *keypadHandle;
 static Servo_t *servoHandle;
-static UART_HandleTypeDef *uartHandle;
-static volatile char uartBuffer = 0; // Buffer for ISR
 
 // Helper Functions
-static void TransitionTo(SystemState_t newState);
 static void ClearInput(void);
 static void SM_Print(const char *str);
-static void SM_Clear(void);
 static void SM_SetCursor(uint8_t col, uint8_t row);
+static void SM_Flush(void);
+static void SM_Show(const LCD_Screen_t *screen);
+static void SM_Log(const char *str);
+static void SM_Icon(const uint8_t *glyph);
+static void SM_DrawCountdown(uint32_t remaining, uint32_t total);
 static void SM_ProcessUART(char key);
 static bool SM_IsDoorOpen(void);
+static void SM_OnCards(uint8_t count, const MFRC522_Uid_t *uids);
+static void SM_CheckCard(uint32_t arg);
+static bool SM_KeyPending(void);
+static bool SM_RxPending(void);
+static void SM_OnKeypadScan(uint32_t arg);
+static void SM_OnKeypad(uint32_t arg);
+static void SM_OnUART(uint32_t arg);
+static void SM_OnDoorSample(uint32_t arg);
+static void SM_OnTimer(uint32_t event);
+static void SM_KickCard(void);
+static void SM_ArmStateTimer(uint32_t ms);
+static uint32_t SM_UidHash(const MFRC522_Uid_t *uid);
+static void SM_BuildCardIndex(void);
+static bool SM_IsAuthorized(const MFRC522_Uid_t *uid);
 
 void SM_Init(LiquidCrystal_I2C_t *lcd, Keypad_t *keypad, Servo_t *servo,
              UART_HandleTypeDef *huart) {
   lcdHandle = lcd;
   keypadHandle = keypad;
   servoHandle = servo;
-  uartHandle = huart;
+  UartLog_Init(huart);
+  SM_BuildCardIndex();
+  Fsm_Init(&fsm, SM_STATES, &SM_CELLS[0][0], SM_TRANSITIONS, EV_COUNT,
+           STATE_IDLE);
+  RFID_Init(SM_OnCards); // Reports each card once while it stays on the reader
+
+  SM_Show(&SCREEN_SPLASH);
+  SM_Flush();
+
+  SM_Log("\r\n--- Menu Smart Lock ---\r\n"
+         "Teclas: 0-9, A-D\r\n"
+         "Cmds: 'U'Abrir, 'C'Cerrar\r\n"
+         "-----------------------\r\n");
+
+  // Keys and UART bytes arrive through rings, the rest is polled on a timer.
+  // The keypad timer runs first in a dispatch pass, so the keys it finds are
+  // handled by the source in the same pass. The reader runs when its IRQ
+  // line fires or when the deadline it asked for comes up.
+  Sched_AddSource(SM_KeyPending, SM_OnKeypad);
+  Sched_AddSource(SM_RxPending, SM_OnUART);
+  Sched_AddSource(MFRC522_IrqPending, SM_CheckCard);
+  Timer_StartPeriodic(&keypadTimer, KEYPAD_SCAN_MS, SM_OnKeypadScan, 0);
+  SM_KickCard();
+  Timer_StartPeriodic(&doorTimer, DOOR_SAMPLE_PERIOD, SM_OnDoorSample, 0);
+
+  // Splash stays up until the IDLE timeout (a key skips it)
+  SM_ArmStateTimer(SPLASH_TIME);
+}
 
-  SM_Clear();
-  SM_Print("Smart Lock Listo");
-  SM_SetCursor(0, 1);
-  SM_Print("Teclas:0-9 A-D");
-  HAL_Delay(1000);
-
-  if (uartHandle != NULL) {
-    char *menu = "\r\n--- Menu Smart Lock ---\r\n"
-                 "Teclas: 0-9, A-D\r\n"
-                 "Cmds: 'U'Abrir, 'C'Cerrar\r\n"
-                 "-----------------------\r\n";
-    HAL_UART_Transmit(uartHandle, (uint8_t *)menu, strlen(menu), 100);
-  }
+// Every handler below runs to completion from Sched_Dispatch and pushes
+// whatever it drew with a final SM_Flush.
+
+static bool SM_KeyPending(void) { return Keypad_HasKey(keypadHandle); }
 
-  TransitionTo(STATE_IDLE);
+static void SM_OnKeypadScan(uint32_t arg) {
+  (void)arg;
+  Keypad_Scan(keypadHandle);
 }
 
-void SM_Run(void) {
-  // 1. Check Keypad
-  char key = Keypad_GetKey(keypadHandle);
-  if (key) {
+static bool SM_RxPending(void) { return !SM_RxRing_IsEmpty(&rx); }
+
+// Drain every key queued since the last pass, in order
+static void SM_OnKeypad(uint32_t arg) {
+  (void)arg;
+  char key;
+  while ((key = Keypad_GetKey(keypadHandle)) != 0) {
     SM_HandleKey(key);
   }
+  SM_Flush();
+}
 
-  // 1.5 Check UART Buffer (Process out of ISR)
-  if (uartBuffer != 0) {
-    char k = uartBuffer;
-    uartBuffer = 0;
-    SM_ProcessUART(k);
+static void SM_OnUART(uint32_t arg) {
+  (void)arg;
+  char key;
+  while (SM_RxRing_Pop(&rx, &key)) {
+    SM_ProcessUART(key);
   }
+  SM_Flush();
+}
 
-  // 2. Check Card (only in IDLE)
-  if (currentState == STATE_IDLE) {
-    if (SM_CheckCard()) {
-      TransitionTo(STATE_ACCESS_GRANTED);
-    }
+// Reed switch sampled every DOOR_SAMPLE_PERIOD; only the edges are events
+static void SM_OnDoorSample(uint32_t arg) {
+  (void)arg;
+  bool open = SM_IsDoorOpen();
+
+  if (open != doorWasOpen) {
+    doorWasOpen = open;
+    Fsm_Dispatch(&fsm, open ? EV_DOOR_OPEN : EV_DOOR_CLOSED, 0);
+    SM_Flush();
   }
+}
 
-  // 3. Timeouts / Auto-actions
-  uint32_t elapsed = HAL_GetTick() - stateEntryTime;
-
-  switch (currentState) {
-  case STATE_ACCESS_GRANTED:
-    // Logic with Reed Switch
-    if (SM_IsDoorOpen()) {
-      // Door is physically OPEN
-      // Reset the entry time so we don't close immediately after it shuts
-      // But we want to track how long it's been open for the alert
-      if (doorOpenTime == 0) {
-        doorOpenTime = HAL_GetTick();
-      }
+// stateTimer, countdownTimer and doorAlertTimer carry their event as 'arg'
+static void SM_OnTimer(uint32_t event) {
+  Fsm_Dispatch(&fsm, (uint8_t)event, 0);
+  SM_Flush();
+}
 
-      // Check if open too long (e.g., 15 seconds)
-      if ((HAL_GetTick() - doorOpenTime > 15000) && !alertShown) {
-        SM_Clear();
-        SM_Print("ABIERTO");
-        alertShown = true;
-      }
-    } else {
-      // Door is physically CLOSED
-      doorOpenTime = 0; // Reset open timer
-      alertShown = false;
-    }
-    break;
+static void SM_ArmStateTimer(uint32_t ms) {
+  Timer_Start(&stateTimer, ms, SM_OnTimer, EV_TIMEOUT);
+}
 
-  case STATE_ACCESS_DENIED:
-    if (elapsed > 2000) {
-      TransitionTo(STATE_IDLE);
-    }
-    break;
+void SM_HandleKey(char key) {
+  RFID_Activity(); // Someone is at the door: poll the reader faster
+  SM_KickCard();
+  Fsm_Dispatch(&fsm, key == 'A' ? EV_KEY_A : EV_KEY, (uint8_t)key);
+}
 
-  case STATE_INPUT_CODE:
-    if (elapsed > 10000) { // 10s timeout for input
-      TransitionTo(STATE_IDLE);
-    }
-    break;
+// --- Entry/exit actions ---
 
-  case STATE_BLOCKED:
-    if (elapsed > 30000) { // 30s block
-      failedAttempts = 0;
-      TransitionTo(STATE_IDLE);
-    }
-    break;
+// Any transition out of a state drops its timeouts
+static void SM_ExitState(uint32_t arg) {
+  (void)arg;
+  Timer_Stop(&stateTimer);
+  Timer_Stop(&countdownTimer);
+  Timer_Stop(&doorAlertTimer);
+  SM_KickCard(); // The reader only accepts new cards in IDLE
+}
+
+static void SM_EnterIdle(uint32_t arg) {
+  (void)arg;
+  Servo_Close(servoHandle);
+  SM_Show(&SCREEN_IDLE);
+  SM_Icon(GLYPH_LOCK);
+  ClearInput();
+}
 
-  default:
-    break;
+static void SM_EnterInputCode(uint32_t arg) {
+  (void)arg;
+  SM_Show(&SCREEN_INPUT_CODE);
+  SM_Icon(GLYPH_KEY);
+  SM_SetCursor(0, 1);
+  for (uint8_t i = 0; i < codeIndex; i++) {
+    SM_Print("*"); // The key that left IDLE
   }
+  SM_ArmStateTimer(INPUT_TIMEOUT);
 }
 
-void SM_HandleKey(char key) {
-  if (currentState == STATE_BLOCKED)
-    return; // Ignore keys when blocked
+static void SM_EnterGranted(uint32_t arg) {
+  (void)arg;
+  Servo_Open(servoHandle);
+  SM_Show(&SCREEN_GRANTED);
+  SM_Icon(GLYPH_UNLOCK);
+  doorWasOpen = false; // Next sample reports it if it is open
+  SM_ArmStateTimer(AUTO_CLOSE_DELAY);
+}
 
-  switch (currentState) {
-  case STATE_IDLE:
-    if (key == 'A') {
-      TransitionTo(STATE_CHANGE_PWD_AUTH);
-    } else {
-      TransitionTo(STATE_INPUT_CODE);
-      currentCode[codeIndex++] = key;
-      SM_Print("*");
-    }
-    break;
+static void SM_EnterDenied(uint32_t arg) {
+  (void)arg;
+  char buf[16];
 
-  case STATE_INPUT_CODE:
-    if (codeIndex < CODE_LENGTH) {
-      currentCode[codeIndex++] = key;
-      SM_Print("*");
-    }
+  SM_Show(&SCREEN_DENIED);
+  SM_SetCursor(0, 1);
+  sprintf(buf, "Intentos: %d/%d", failedAttempts, MAX_ATTEMPTS);
+  SM_Print(buf);
+  SM_ArmStateTimer(DENIED_TIME);
+}
 
-    if (codeIndex >= CODE_LENGTH) {
-      currentCode[CODE_LENGTH] = '\0';
-      TransitionTo(STATE_CHECK_CODE);
-    }
-    break;
+static void SM_EnterBlocked(uint32_t arg) {
+  (void)arg;
+  SM_Show(&SCREEN_BLOCKED);
+  SM_Icon(GLYPH_LOCK);
+  SM_DrawCountdown(BLOCK_TIME, BLOCK_TIME);
+  SM_ArmStateTimer(BLOCK_TIME);
+  Timer_StartPeriodic(&countdownTimer, COUNTDOWN_REFRESH, SM_OnTimer,
+                      EV_COUNTDOWN);
+}
 
-  case STATE_CHANGE_PWD_AUTH:
-    if (codeIndex < CODE_LENGTH) {
-      currentCode[codeIndex++] = key;
-      SM_Print("*");
-    }
-    if (codeIndex >= CODE_LENGTH) {
-      currentCode[CODE_LENGTH] = '\0';
-      if (strcmp(currentCode, savedPassword) == 0) {
-        TransitionTo(STATE_CHANGE_PWD_NEW);
-      } else {
-        TransitionTo(STATE_ACCESS_DENIED);
-      }
-    }
-    break;
+static void SM_EnterPwdAuth(uint32_t arg) {
+  (void)arg;
+  ClearInput();
+  SM_Show(&SCREEN_PWD_AUTH);
+  SM_Icon(GLYPH_KEY);
+  SM_SetCursor(0, 1);
+}
 
-  case STATE_CHANGE_PWD_NEW:
-    if (codeIndex < CODE_LENGTH) {
-      currentCode[codeIndex++] = key;
-      SM_Print("*");
-    }
-    if (codeIndex >= CODE_LENGTH) {
-      currentCode[CODE_LENGTH] = '\0';
-      strcpy(savedPassword, currentCode);
-      // Flash_SavePassword(savedPassword); // Save to Flash
-      // ************************************** Revisar, no agente
-      TransitionTo(STATE_CHANGE_PWD_CONFIRM);
-    }
-    break;
+static void SM_EnterPwdNew(uint32_t arg) {
+  (void)arg;
+  ClearInput();
+  SM_Show(&SCREEN_PWD_NEW);
+  SM_Icon(GLYPH_KEY);
+  SM_SetCursor(0, 1);
+}
 
-  default:
-    break;
-  }
+static void SM_EnterPwdConfirm(uint32_t arg) {
+  (void)arg;
+  SM_Show(&SCREEN_PWD_CHANGED);
+  SM_ArmStateTimer(PWD_CHANGED_TIME);
 }
 
-static void TransitionTo(SystemState_t newState) {
-  currentState = newState;
-  stateEntryTime = HAL_GetTick();
-
-  switch (newState) {
-  case STATE_IDLE:
-    Servo_Close(servoHandle);
-    SM_Clear();
-    SM_SetCursor(0, 0);
-    SM_Print("CERRADO");
-    ClearInput();
-    break;
-
-  case STATE_INPUT_CODE:
-    SM_Clear();
-    SM_Print("Ingrese Codigo: ");
-    SM_SetCursor(0, 1);
-    // If we came from IDLE with a key press, that key is already handled in
-    // HandleKey but we need to reprint it if we cleared screen. Actually,
-    // HandleKey calls TransitionTo FIRST, then prints. So if we transition
-    // here, the screen is clear. The key that triggered IDLE->INPUT will be
-    // printed by HandleKey *after* this returns.
-    break;
-
-  case STATE_CHECK_CODE:
-    if (strcmp(currentCode, savedPassword) == 0) {
-      failedAttempts = 0;
-      TransitionTo(STATE_ACCESS_GRANTED);
-    } else {
-      failedAttempts++;
-      if (failedAttempts >= 3) {
-        TransitionTo(STATE_BLOCKED);
-      } else {
-        TransitionTo(STATE_ACCESS_DENIED);
-      }
-    }
-    break;
-
-  case STATE_ACCESS_GRANTED:
-    Servo_Open(servoHandle);
-    SM_Clear();
-    SM_Print("ABIERTO");
-    break;
-
-  case STATE_ACCESS_DENIED:
-    SM_Clear();
-    SM_Print("Acceso Denegado");
-    SM_SetCursor(0, 1);
-    char buf[16];
-    sprintf(buf, "Intentos: %d/3", failedAttempts);
-    SM_Print(buf);
-    break;
-
-  case STATE_BLOCKED:
-    SM_Clear();
-    SM_Print("SISTEMA BLOQ.");
-    SM_SetCursor(0, 1);
-    SM_Print("Espere 30s...");
-    break;
-
-  case STATE_CHANGE_PWD_AUTH:
-    ClearInput();
-    SM_Clear();
-    SM_Print("Antigua Clave: ");
-    SM_SetCursor(0, 1);
-    break;
-
-  case STATE_CHANGE_PWD_NEW:
-    ClearInput();
-    SM_Clear();
-    SM_Print("Nueva Clave: ");
-    SM_SetCursor(0, 1);
-    break;
-
-  case STATE_CHANGE_PWD_CONFIRM:
-    SM_Clear();
-    SM_Print("Cambiada!");
-    HAL_Delay(1000); // Blocking delay for simplicity
-    TransitionTo(STATE_IDLE);
-    break;
+// --- Guards ---
+
+static bool SM_IsLastDigit(uint32_t key) {
+  (void)key;
+  return codeIndex == CODE_LENGTH - 1;
+}
+
+static bool SM_CodeMatches(uint32_t arg) {
+  (void)arg;
+  return strcmp(currentCode, savedPassword) == 0;
+}
+
+// The code typed so far plus 'key' completes the saved password
+static bool SM_LastDigitMatches(uint32_t key) {
+  return SM_IsLastDigit(key) &&
+         strncmp(currentCode, savedPassword, codeIndex) == 0 &&
+         savedPassword[codeIndex] == (char)key;
+}
+
+static bool SM_IsLastAttempt(uint32_t arg) {
+  (void)arg;
+  return failedAttempts + 1 >= MAX_ATTEMPTS;
+}
+
+// --- Transition actions ---
+
+static void SM_StoreDigit(uint32_t key) {
+  if (codeIndex < CODE_LENGTH) {
+    currentCode[codeIndex++] = (char)key; // Stays NUL-terminated
   }
 }
 
+static void SM_TypeDigit(uint32_t key) {
+  SM_StoreDigit(key);
+  SM_Print("*");
+}
+
+static void SM_SavePassword(uint32_t key) {
+  SM_TypeDigit(key);
+  strcpy(savedPassword, currentCode);
+  // Flash_SavePassword(savedPassword); // Save to Flash
+  // ************************************** Revisar, no agente
+}
+
+static void SM_CountFailure(uint32_t arg) {
+  (void)arg;
+  failedAttempts++;
+}
+
+static void SM_ResetAttempts(uint32_t arg) {
+  (void)arg;
+  failedAttempts = 0;
+}
+
+static void SM_ShowUnauthorized(uint32_t arg) {
+  (void)arg;
+  SM_Show(&SCREEN_UNAUTHORIZED);
+  SM_ArmStateTimer(MESSAGE_TIME); // Then back to the IDLE screen
+}
+
+// While the door is open the auto-close waits and the alert timer runs;
+// once it shuts, the lock closes AUTO_CLOSE_DELAY later
+static void SM_DoorOpened(uint32_t arg) {
+  (void)arg;
+  Timer_Stop(&stateTimer);
+  Timer_Start(&doorAlertTimer, DOOR_ALERT_TIME, SM_OnTimer, EV_DOOR_ALERT);
+}
+
+static void SM_DoorClosed(uint32_t arg) {
+  (void)arg;
+  Timer_Stop(&doorAlertTimer);
+  SM_ArmStateTimer(AUTO_CLOSE_DELAY);
+}
+
+// Door open longer than DOOR_ALERT_TIME
+static void SM_ShowDoorAlert(uint32_t arg) {
+  (void)arg;
+  SM_Show(&SCREEN_GRANTED);
+  SM_Icon(GLYPH_UNLOCK); // Still unlocked: SM_Show wiped the icon cell
+  SM_Log("Puerta abierta!\r\n");
+}
+
+static void SM_ShowRemaining(uint32_t arg) {
+  (void)arg;
+  SM_DrawCountdown(Timer_Remaining(&stateTimer), BLOCK_TIME);
+}
+
 static void ClearInput(void) {
   codeIndex = 0;
   memset(currentCode, 0, sizeof(currentCode));
 }
 
-bool SM_CheckCard(void) {
-  uint8_t status;
-  uint8_t str[MAX_LEN]; // Ensure MAX_LEN is defined or use 16
-
-  // 1. Request Card
-  status = MFRC522_Request(PICC_REQIDL, str);
-  if (status == MI_OK) {
-    // 2. Anti-collision (Get UID)
-    status = MFRC522_Anticoll(str);
-    if (status == MI_OK) {
-      // Card Detected!
-      // str[0]..str[3] is the UID.
-
-      // Debug Print UID
-      char uidStr[32];
-      sprintf(uidStr, "UID: %02X%02X%02X%02X", str[0], str[1], str[2], str[3]);
-      SM_Print(uidStr);
-      HAL_Delay(3000);
-
-      // Verify UID
-      bool authorized = true;
-      for (int i = 0; i < 4; i++) {
-        if (str[i] != AUTHORIZED_UID[i]) {
-          authorized = false;
-          break;
-        }
-      }
+// Run the reader now instead of at its pending deadline
+static void SM_KickCard(void) { Timer_Start(&cardTimer, 0, SM_CheckCard, 0); }
+
+static void SM_CheckCard(uint32_t arg) {
+  (void)arg;
+  // New cards arrive through SM_OnCards. Outside IDLE only cards already on
+  // the reader keep being tracked.
+  uint8_t state = Fsm_State(&fsm);
+  uint32_t next = RFID_Run(state == STATE_IDLE);
+  if (Fsm_State(&fsm) == state) { // Else a card moved the FSM: kicked again
+    Timer_Start(&cardTimer, next, SM_CheckCard, 0);
+  }
+  SM_Flush();
+}
 
-      if (authorized) {
-        return true;
-      } else {
-        SM_Clear();
-        SM_Print("No Autorizado");
-        HAL_Delay(2000);
-        TransitionTo(STATE_IDLE); // Return to idle to clear screen
-        return false;
-      }
+// Cards that just arrived on the reader (each one is reported only once)
+static void SM_OnCards(uint8_t count, const MFRC522_Uid_t *uids) {
+  // Keys or UART may have moved on while the exchange was in flight
+  if (Fsm_State(&fsm) != STATE_IDLE) {
+    return;
+  }
+
+  // Card(s) Detected! Any authorized card in a wallet opens the lock.
+  bool authorized = false;
+  for (uint8_t c = 0; c < count; c++) {
+    const MFRC522_Uid_t *uid = &uids[c];
+
+    // Debug Print UID
+    char uidStr[8 + 2 * MFRC522_UID_MAX];
+    int len = sprintf(uidStr, "UID:");
+    for (uint8_t i = 0; i < uid->size; i++) {
+      len += sprintf(&uidStr[len], "%02X", uid->bytes[i]);
+    }
+    SM_SetCursor(0, 1 + c % (LCD_MAX_ROWS - 1));
+    SM_Print(uidStr);
+
+    if (SM_IsAuthorized(uid)) {
+      authorized = true;
+    }
+  }
+  SM_Flush();
+
+  Fsm_Dispatch(&fsm, authorized ? EV_CARD_OK : EV_CARD_DENIED, 0);
+}
+
+// FNV-1a over the fixed-size key (size + zero-padded UID bytes)
+static uint32_t SM_UidHash(const MFRC522_Uid_t *uid) {
+  uint32_t hash = 2166136261u ^ uid->size;
+  hash *= 16777619u;
+  for (uint8_t i = 0; i < MFRC522_UID_MAX; i++) {
+    hash = (hash ^ uid->bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static void SM_BuildCardIndex(void) {
+  memset(cardIndex, 0, sizeof(cardIndex));
+  for (uint8_t i = 0; i < AUTHORIZED_COUNT; i++) {
+    uint32_t slot = SM_UidHash(&AUTHORIZED_CARDS[i]);
+    while (cardIndex[slot & (CARD_INDEX_SLOTS - 1)] != 0) {
+      slot++;
     }
+    cardIndex[slot & (CARD_INDEX_SLOTS - 1)] = i + 1;
+  }
+}
+
+// One hash and, in practice, one fixed-length compare per read card
+static bool SM_IsAuthorized(const MFRC522_Uid_t *uid) {
+  uint32_t slot = SM_UidHash(uid);
+  uint8_t entry;
+
+  while ((entry = cardIndex[slot & (CARD_INDEX_SLOTS - 1)]) != 0) {
+    const MFRC522_Uid_t *card = &AUTHORIZED_CARDS[entry - 1];
+    if (card->size == uid->size &&
+        memcmp(card->bytes, uid->bytes, MFRC522_UID_MAX) == 0) {
+      return true;
+    }
+    slot++;
   }
   return false;
 }
 
 static void SM_Print(const char *str) {
-  LiquidCrystal_I2C_print(lcdHandle, (char *)str);
-  if (uartHandle != NULL) {
-    HAL_UART_Transmit(uartHandle, (uint8_t *)str, strlen(str), 1000);
+  LiquidCrystal_I2C_fbPrint(lcdHandle, str);
+  SM_Log(str);
+}
+
+static void SM_SetCursor(uint8_t col, uint8_t row) {
+  LiquidCrystal_I2C_fbSetCursor(lcdHandle, col, row);
+  // ANSI Set Cursor REMOVED for scrolling log
+  // If moving to 2nd line (row > 0), just print newline
+  if (row > 0) {
+    SM_Log("\r\n");
   }
 }
 
-static void SM_Clear(void) {
-  LiquidCrystal_I2C_clear(lcdHandle);
-  if (uartHandle != NULL) {
-    // ANSI Clear Screen REMOVED for scrolling log
-    // Just print a separator or newline
-    const char *sep = "\r\n----------------\r\n";
-    HAL_UART_Transmit(uartHandle, (uint8_t *)sep, strlen(sep), 1000);
+// Replace the whole screen with a pre-encoded one (sent immediately, one
+// burst). The UART log gets the screen text, one line per non-empty row.
+static void SM_Show(const LCD_Screen_t *screen) {
+  LiquidCrystal_I2C_showScreen(lcdHandle, screen);
+  // ANSI Clear Screen REMOVED for scrolling log
+  // Just print a separator or newline
+  SM_Log("\r\n----------------\r\n");
+  for (uint8_t row = 0; row < LCD_MAX_ROWS; row++) {
+    if (screen->rows[row][0] != '\0') {
+      if (row > 0) {
+        SM_Log("\r\n");
+      }
+      SM_Log(screen->rows[row]);
+    }
   }
 }
 
-static void SM_SetCursor(uint8_t col, uint8_t row) {
-  LiquidCrystal_I2C_setCursor(lcdHandle, col, row);
-  if (uartHandle != NULL) {
-    // ANSI Set Cursor REMOVED for scrolling log
-    // If moving to 2nd line (row > 0), just print newline
-    if (row > 0) {
-      const char *nl = "\r\n";
-      HAL_UART_Transmit(uartHandle, (uint8_t *)nl, strlen(nl), 1000);
+// Queued and sent by UART interrupts; never waits for the line
+static void SM_Log(const char *str) { UartLog_Write(str); }
+
+// Send the cells that changed since the last flush (drawing is RAM-only)
+static void SM_Flush(void) { LiquidCrystal_I2C_commit(lcdHandle); }
+
+// LCD-only status icon in the last column of the first row. Glyphs stay
+// resident in CGRAM, so redrawing a screen does not upload them again.
+static void SM_Icon(const uint8_t *glyph) {
+  LiquidCrystal_I2C_fbSetCursor(lcdHandle, lcdHandle->_cols - 1, 0);
+  LiquidCrystal_I2C_fbWrite(lcdHandle,
+                            LiquidCrystal_I2C_glyph(lcdHandle, glyph));
+}
+
+// Remaining seconds on the second row and a draining bar on the third
+// (LCD-only, redrawn every pass; the commit only sends what changed)
+static void SM_DrawCountdown(uint32_t remaining, uint32_t total) {
+  uint8_t width = lcdHandle->_cols;
+  uint32_t fill = remaining * width * 5 / total; // In pixel columns
+  char buf[24]; // "Espere " + any unsigned long + "s..."
+
+  snprintf(buf, sizeof buf, "Espere %2lus...",
+           (unsigned long)((remaining + 999) / 1000));
+  LiquidCrystal_I2C_fbSetCursor(lcdHandle, 0, 1);
+  LiquidCrystal_I2C_fbPrint(lcdHandle, buf);
+
+  LiquidCrystal_I2C_fbSetCursor(lcdHandle, 0, 2);
+  for (uint8_t i = 0; i < width; i++) {
+    uint32_t cols = fill > 5 ? 5 : fill;
+    fill -= cols;
+    if (cols == 5) {
+      LiquidCrystal_I2C_fbWrite(lcdHandle, LCD_FULL_BLOCK);
+    } else if (cols == 0) {
+      LiquidCrystal_I2C_fbWrite(lcdHandle, ' ');
+    } else {
+      LiquidCrystal_I2C_fbWrite(
+          lcdHandle, LiquidCrystal_I2C_glyph(lcdHandle, GLYPH_BAR[cols - 1]));
     }
   }
 }
 
 void SM_HandleUART(char key) {
-  uartBuffer = key; // Just buffer it, don't process (LCD/I2C) in ISR!
+  // Just queue it, don't process (LCD/I2C) in ISR!
+  SM_RxRing_Push(&rx, key);
 }
 
 static void SM_ProcessUART(char key) {
   // 1. Command 'U': Open
   if (key == 'U') {
-    TransitionTo(STATE_ACCESS_GRANTED);
+    Fsm_Dispatch(&fsm, EV_UNLOCK, 0);
     return;
   }
 
   // 2. Command 'C': Close (Replacing 'L')
   if (key == 'C') {
-    TransitionTo(STATE_IDLE);
+    Fsm_Dispatch(&fsm, EV_LOCK, 0);
     return;
   }
 
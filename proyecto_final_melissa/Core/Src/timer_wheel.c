@@ -0,0 +1,154 @@
+#include "timer_wheel.h"
+
+#define TIMER_SLOT_MASK (TIMER_SLOTS - 1)
+
+static Timer_t *wheel[TIMER_LEVELS][TIMER_SLOTS];
+static Timer_t *expired; // Waiting for their handler
+static volatile uint32_t wheelTime = 0;
+
+static void Timer_Link(Timer_t **head, Timer_t *t) {
+  t->next = *head;
+  if (t->next != NULL) {
+    t->next->pprev = &t->next;
+  }
+  *head = t;
+  t->pprev = head;
+}
+
+static void Timer_Unlink(Timer_t *t) {
+  *t->pprev = t->next;
+  if (t->next != NULL) {
+    t->next->pprev = t->pprev;
+  }
+  t->next = NULL;
+  t->pprev = NULL;
+}
+
+// Lowest level whose slot for 't->expires' comes up within one turn
+static void Timer_Insert(Timer_t *t) {
+  uint32_t now = wheelTime;
+
+  if (t->expires - now > TIMER_MAX_MS) {
+    t->expires = now + TIMER_MAX_MS;
+  }
+  for (uint8_t level = 0; level < TIMER_LEVELS; level++) {
+    uint8_t shift = level * TIMER_SLOT_BITS;
+    if ((t->expires >> shift) - (now >> shift) < TIMER_SLOTS) {
+      Timer_Link(&wheel[level][(t->expires >> shift) & TIMER_SLOT_MASK], t);
+      return;
+    }
+  }
+}
+
+static void Timer_Arm(Timer_t *t, uint32_t ms, uint32_t period,
+                      Timer_Handler_t handler, uint32_t arg) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  if (t->pprev != NULL) {
+    Timer_Unlink(t);
+  }
+  t->handler = handler;
+  t->arg = arg;
+  t->period = period;
+  t->expires = wheelTime + (ms != 0 ? ms : 1); // Slot 'now' already passed
+  Timer_Insert(t);
+
+  __set_PRIMASK(primask);
+}
+
+void Timer_Start(Timer_t *t, uint32_t ms, Timer_Handler_t handler,
+                 uint32_t arg) {
+  Timer_Arm(t, ms, 0, handler, arg);
+}
+
+void Timer_StartPeriodic(Timer_t *t, uint32_t ms, Timer_Handler_t handler,
+                         uint32_t arg) {
+  Timer_Arm(t, ms, ms, handler, arg);
+}
+
+void Timer_Stop(Timer_t *t) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (t->pprev != NULL) {
+    Timer_Unlink(t);
+  }
+  __set_PRIMASK(primask);
+}
+
+bool Timer_IsArmed(const Timer_t *t) { return t->pprev != NULL; }
+
+uint32_t Timer_Remaining(const Timer_t *t) {
+  uint32_t primask = __get_PRIMASK();
+  uint32_t remaining = 0;
+
+  __disable_irq();
+  if (t->pprev != NULL && (int32_t)(t->expires - wheelTime) > 0) {
+    remaining = t->expires - wheelTime;
+  }
+  __set_PRIMASK(primask);
+  return remaining;
+}
+
+// Re-insert every timer of a higher-level slot one level down (or lower)
+static void Timer_Cascade(uint8_t level, uint8_t slot) {
+  Timer_t *t = wheel[level][slot];
+
+  wheel[level][slot] = NULL;
+  while (t != NULL) {
+    Timer_t *next = t->next;
+    t->next = NULL;
+    t->pprev = NULL;
+    Timer_Insert(t);
+    t = next;
+  }
+}
+
+void Timer_Tick(void) {
+  uint32_t now = ++wheelTime;
+
+  // Higher levels first, so their timers can still land in the level 0
+  // slot that expires on this same tick
+  for (uint8_t level = TIMER_LEVELS - 1; level > 0; level--) {
+    uint8_t shift = level * TIMER_SLOT_BITS;
+    if ((now & ((1u << shift) - 1)) == 0) {
+      Timer_Cascade(level, (now >> shift) & TIMER_SLOT_MASK);
+    }
+  }
+
+  Timer_t *t = wheel[0][now & TIMER_SLOT_MASK];
+  while (t != NULL) {
+    Timer_t *next = t->next;
+    Timer_Unlink(t);
+    Timer_Link(&expired, t);
+    t = next;
+  }
+}
+
+bool Timer_HasExpired(void) { return expired != NULL; }
+
+void Timer_RunExpired(void) {
+  for (;;) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    Timer_t *t = expired;
+    if (t == NULL) {
+      __set_PRIMASK(primask);
+      return;
+    }
+    Timer_Unlink(t);
+    if (t->period != 0) {
+      t->expires += t->period;
+      if ((int32_t)(t->expires - wheelTime) <= 0) {
+        t->expires = wheelTime + t->period; // Fell behind: skip missed periods
+      }
+      Timer_Insert(t);
+    }
+    Timer_Handler_t handler = t->handler;
+    uint32_t arg = t->arg;
+
+    __set_PRIMASK(primask);
+    handler(arg); // May re-arm or stop 't' (or any other timer)
+  }
+}
@@ -0,0 +1,38 @@
+#include "timing.h"
+
+static uint32_t cyclesPerUs = 1;
+
+void Timing_Init(void) {
+  // SystemCoreClock is refreshed by HAL_RCC_ClockConfig, so this picks up
+  // the real core clock whatever the PLL and flash wait states are
+  cyclesPerUs = SystemCoreClock / 1000000U;
+  if (cyclesPerUs == 0) {
+    cyclesPerUs = 1;
+  }
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void Timing_DelayUs(uint32_t us) {
+  uint32_t start = DWT->CYCCNT;
+  uint32_t cycles = us * cyclesPerUs;
+  while ((DWT->CYCCNT - start) < cycles) {
+  }
+}
+
+uint32_t Timing_DeadlineUs(uint32_t us) {
+  return DWT->CYCCNT + us * cyclesPerUs;
+}
+
+bool Timing_Expired(uint32_t deadline) {
+  // Signed difference keeps working across counter wrap-around
+  return (int32_t)(DWT->CYCCNT - deadline) >= 0;
+}
+
+uint32_t Timing_ElapsedUs(uint32_t startCycles) {
+  return (DWT->CYCCNT - startCycles) / cyclesPerUs;
+}
+
+uint32_t Timing_CyclesToUs(uint32_t cycles) { return cycles / cyclesPerUs; }
@@ -0,0 +1,54 @@
+#include "uart_log.h"
+#include <stdbool.h>
+
+static UART_HandleTypeDef *uart;
+static char buffer[UART_LOG_BUFFER_LEN];
+static volatile uint16_t head = 0; // Next free byte
+static volatile uint16_t tail = 0; // Next byte to send
+static volatile uint16_t sending = 0; // Bytes in the transfer in flight
+
+// Send the longest contiguous run after 'tail' (called with IRQs masked)
+static void UartLog_Start(void) {
+  if (sending != 0 || head == tail) {
+    return;
+  }
+  uint16_t len = (head > tail) ? head - tail : UART_LOG_BUFFER_LEN - tail;
+  if (HAL_UART_Transmit_IT(uart, (uint8_t *)&buffer[tail], len) == HAL_OK) {
+    sending = len;
+  }
+}
+
+void UartLog_Init(UART_HandleTypeDef *huart) {
+  uart = huart;
+  head = 0;
+  tail = 0;
+  sending = 0;
+}
+
+void UartLog_Write(const char *str) {
+  if (uart == NULL) {
+    return;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (; *str != '\0'; str++) {
+    uint16_t next = (head + 1) & (UART_LOG_BUFFER_LEN - 1);
+    if (next == tail) {
+      break; // Full: drop the rest
+    }
+    buffer[head] = *str;
+    head = next;
+  }
+  UartLog_Start();
+  __set_PRIMASK(primask);
+}
+
+void UartLog_TxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart != uart || sending == 0) {
+    return;
+  }
+  tail = (tail + sending) & (UART_LOG_BUFFER_LEN - 1);
+  sending = 0;
+  UartLog_Start();
+}
@@ -0,0 +1,330 @@
+#!/usr/bin/env python3
+"""Generate the lock state machine tables from Core/state_machine.mmd.
+
+Usage: fsm_gen.py SPEC.mmd OUTPUT.h [--doc DOC.md]
+
+Runs as a pre-build step. Any problem in the spec (unreachable state, state
+with no way out, guarded entry without a fallback, ...) is printed as
+"file:line: error: ..." and the build stops. With --doc, the stateDiagram-v2
+block of the documentation is replaced by the spec so both stay in sync.
+"""
+
+import re
+import sys
+
+STATE_PREFIX = "STATE_"
+NO_TRANSITION = "FSM_NO_TRANSITION"
+NO_CELL = "FSM_NO_CELL"
+COMPLETION = "EV_COMPLETION"
+
+IDENT = r"[A-Za-z_]\w*"
+RE_INITIAL = re.compile(r"^\[\*\]\s*-->\s*(%s)$" % IDENT)
+RE_ANY = re.compile(r"^%%%%\s*any\s*-->\s*(%s)\s*:\s*(.+)$" % IDENT)
+RE_TRANSITION = re.compile(r"^(%s)\s*-->\s*(%s)\s*:\s*(.+)$" % (IDENT, IDENT))
+RE_STATE_ACTION = re.compile(r"^(%s)\s*:\s*(entry|exit)\s*/\s*(%s)$" % (IDENT, IDENT))
+RE_LABEL = re.compile(
+    r"^(?P<events>%s(?:\s*,\s*%s)*)"
+    r"(?:\s*\[(?P<guard>%s)\])?"
+    r"(?:\s*/\s*(?P<action>%s))?"
+    r"(?P<internal>\s*\(internal\))?$" % (IDENT, IDENT, IDENT, IDENT)
+)
+
+errors = []
+
+
+def error(where, msg):
+    errors.append("%s:%d: error: %s" % (where[0], where[1], msg))
+
+
+def add_unique(items, name):
+    if name not in items:
+        items.append(name)
+
+
+class Spec:
+    def __init__(self, path):
+        self.path = path
+        self.initial = None
+        self.states = []  # Initial first, then in order of their own lines
+        self.where = {}  # State -> first line that names it
+        self.events = [COMPLETION]
+        self.entry = {}
+        self.exit = {}
+        self.cells = {}  # (state, event) -> [(guard, action, next, where)]
+        self.any = []  # (target, label, where)
+        self.guards = []
+        self.actions = []
+
+
+def parse_label(spec, label, where):
+    m = RE_LABEL.match(label.strip())
+    if not m:
+        error(where, "bad label '%s' (EVENT [Guard] / Action (internal))" % label)
+        return None
+    events = [e.strip() for e in m.group("events").split(",")]
+    for e in events:
+        if not e.startswith("EV_"):
+            error(where, "event '%s' must start with EV_" % e)
+        add_unique(spec.events, e)
+    if m.group("guard"):
+        add_unique(spec.guards, m.group("guard"))
+    if m.group("action"):
+        add_unique(spec.actions, m.group("action"))
+    return events, m.group("guard"), m.group("action"), bool(m.group("internal"))
+
+
+def add_state(spec, states, name, where):
+    add_unique(states, name)
+    spec.where.setdefault(name, where)
+
+
+def add_transition(spec, src, dst, label, where):
+    parsed = parse_label(spec, label, where)
+    if parsed is None:
+        return
+    events, guard, action, internal = parsed
+    if internal and src != dst:
+        error(where, "internal transition must stay in %s" % src)
+    nxt = NO_TRANSITION if internal else STATE_PREFIX + dst
+    for e in events:
+        spec.cells.setdefault((src, e), []).append((guard, action, nxt, where))
+
+
+def parse(path, lines):
+    spec = Spec(path)
+    targets = []  # States only ever seen as a target go last
+    in_diagram = False
+    for n, raw in enumerate(lines, 1):
+        where = (path, n)
+        line = raw.strip()
+        if not line:
+            continue
+        m = RE_ANY.match(line)
+        if m:
+            spec.any.append((m.group(1), m.group(2), where))
+            continue
+        if line.startswith("%%"):
+            continue
+        if line == "stateDiagram-v2":
+            in_diagram = True
+            continue
+        if not in_diagram:
+            error(where, "expected 'stateDiagram-v2'")
+            continue
+
+        m = RE_INITIAL.match(line)
+        if m:
+            if spec.initial is not None:
+                error(where, "more than one initial state")
+            spec.initial = m.group(1)
+            spec.where.setdefault(spec.initial, where)
+            continue
+        m = RE_TRANSITION.match(line)
+        if m:
+            add_state(spec, spec.states, m.group(1), where)
+            add_state(spec, targets, m.group(2), where)
+            add_transition(spec, m.group(1), m.group(2), m.group(3), where)
+            continue
+        m = RE_STATE_ACTION.match(line)
+        if m:
+            state, kind, action = m.groups()
+            add_state(spec, spec.states, state, where)
+            table = spec.entry if kind == "entry" else spec.exit
+            if state in table:
+                error(where, "%s has two %s actions" % (state, kind))
+            table[state] = action
+            add_unique(spec.actions, action)
+            continue
+        error(where, "cannot parse '%s'" % line)
+
+    if spec.initial is None:
+        error((path, len(lines)), "no initial state ([*] --> STATE)")
+        return spec
+    for state in targets:
+        add_unique(spec.states, state)
+    # Keep the initial state first (value 0)
+    if spec.initial in spec.states:
+        spec.states.remove(spec.initial)
+    spec.states.insert(0, spec.initial)
+
+    # "any" transitions go after the state's own entries for that event
+    for dst, label, where in spec.any:
+        add_state(spec, spec.states, dst, where)
+        for src in spec.states:
+            add_transition(spec, src, dst, label, where)
+    return spec
+
+
+def check(spec):
+    # Entry lists: only the last one may (and must) be unguarded
+    for (state, event), entries in spec.cells.items():
+        for i, (guard, _, _, where) in enumerate(entries):
+            last = i == len(entries) - 1
+            if guard is None and not last:
+                error(where, "%s/%s: unguarded entry hides the ones after it"
+                      % (state, event))
+            if guard is not None and last:
+                error(where, "%s/%s: last entry is guarded, add a fallback"
+                      % (state, event))
+
+    # Every state reachable from the initial one
+    reached = {spec.initial}
+    todo = [spec.initial]
+    while todo:
+        src = todo.pop()
+        for (state, _), entries in spec.cells.items():
+            if state != src:
+                continue
+            for _, _, nxt, _ in entries:
+                dst = nxt[len(STATE_PREFIX):] if nxt != NO_TRANSITION else src
+                if dst not in reached:
+                    reached.add(dst)
+                    todo.append(dst)
+    for state in spec.states:
+        if state not in reached:
+            error(spec.where[state], "state %s is unreachable" % state)
+
+    # Every state has a way out (no dead ends)
+    for state in spec.states:
+        leaves = any(s == state and any(nxt not in (NO_TRANSITION,
+                                                    STATE_PREFIX + state)
+                                        for _, _, nxt, _ in entries)
+                     for (s, _), entries in spec.cells.items())
+        if not leaves:
+            error(spec.where[state], "state %s has no transition out" % state)
+
+    if len(spec.states) >= 0xFF:
+        error((spec.path, 0), "too many states")
+
+
+def wrap(prefix, items, suffix, width=80):
+    lines = [prefix]
+    for i, item in enumerate(items):
+        text = item + (", " if i < len(items) - 1 else "")
+        if len(lines[-1]) + len(text.rstrip()) > width:
+            lines[-1] = lines[-1].rstrip()
+            lines.append(" " * len(prefix))
+        lines[-1] += text
+    lines[-1] += suffix
+    return "\n".join(lines)
+
+
+def generate(spec, spec_name):
+    # Pack: one array of entries, identical lists shared, byte index per cell
+    transitions = []
+    lists = {}
+    cell_index = {}
+    for key, entries in spec.cells.items():
+        body = tuple((g, a, nxt) for g, a, nxt, _ in entries)
+        if body not in lists:
+            lists[body] = len(transitions)
+            transitions.extend(body)
+        cell_index[key] = lists[body]
+    if len(transitions) >= 0xFF:
+        error((spec.path, 0), "too many transitions for a byte index")
+
+    out = []
+    w = out.append
+    w("// Generated by fsm_gen.py from %s. Do not edit." % spec_name)
+    w("#ifndef STATE_MACHINE_FSM_H")
+    w("#define STATE_MACHINE_FSM_H")
+    w("")
+    w("typedef enum {")
+    for s in spec.states:
+        w("  %s%s," % (STATE_PREFIX, s))
+    w("  STATE_COUNT")
+    w("} SystemState_t;")
+    w("")
+    w("// Tables: included once, by state_machine.c")
+    w("#ifdef SM_FSM_TABLES")
+    w('#include "fsm.h"')
+    w("")
+    w("typedef enum {")
+    w("  %s = FSM_EV_COMPLETION," % COMPLETION)
+    for e in spec.events[1:]:
+        w("  %s," % e)
+    w("  EV_COUNT")
+    w("} SM_Event_t;")
+    w("")
+    for g in spec.guards:
+        w("static bool %s(uint32_t arg);" % g)
+    for a in spec.actions:
+        w("static void %s(uint32_t arg);" % a)
+    w("")
+    w("static const Fsm_StateDef_t SM_STATES[STATE_COUNT] = {")
+    for s in spec.states:
+        w("    [%s%s] = {%s, %s}," % (STATE_PREFIX, s, spec.entry.get(s, "NULL"),
+                                    spec.exit.get(s, "NULL")))
+    w("};")
+    w("")
+    w("static const Fsm_Transition_t SM_TRANSITIONS[] = {")
+    for i, (g, a, nxt) in enumerate(transitions):
+        w("    /* %2d */ {%s, %s, %s}," % (i, g or "NULL", a or "NULL", nxt))
+    w("};")
+    w("")
+    w("// Index of the first SM_TRANSITIONS entry per [state][event]")
+    w("static const uint8_t SM_CELLS[STATE_COUNT][EV_COUNT] = {")
+    for s in spec.states:
+        row = [str(cell_index[(s, e)]) if (s, e) in cell_index else NO_CELL
+               for e in spec.events]
+        w("    [%s%s] =" % (STATE_PREFIX, s))
+        w(wrap("        {", row, "},"))
+    w("};")
+    w("")
+    w("_Static_assert(sizeof(SM_TRANSITIONS) / sizeof(SM_TRANSITIONS[0]) < "
+      "%s," % NO_CELL)
+    w('               "SM_TRANSITIONS does not fit a byte index");')
+    w("_Static_assert(STATE_COUNT < %s, \"Too many states\");" % NO_TRANSITION)
+    w("#endif // SM_FSM_TABLES")
+    w("")
+    w("#endif")
+    return "\n".join(out) + "\n"
+
+
+def sync_doc(doc_path, spec_lines):
+    with open(doc_path, encoding="utf-8") as f:
+        doc = f.read()
+    block = "```mermaid\n" + "".join(spec_lines).rstrip("\n") + "\n```"
+    new, count = re.subn(r"```mermaid\n(?:%%.*\n)*stateDiagram-v2\n.*?```",
+                         lambda _: block, doc, flags=re.S)
+    if count != 1:
+        error((doc_path, 0), "expected one stateDiagram-v2 block")
+        return
+    if new != doc:
+        with open(doc_path, "w", encoding="utf-8") as f:
+            f.write(new)
+
+
+def main(argv):
+    if len(argv) not in (3, 5) or (len(argv) == 5 and argv[3] != "--doc"):
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    spec_path, out_path = argv[1], argv[2]
+    with open(spec_path, encoding="utf-8") as f:
+        lines = f.readlines()
+
+    spec = parse(spec_path, lines)
+    if spec.initial is not None:
+        check(spec)
+    header = generate(spec, spec_path.replace("\\", "/").split("/")[-1]) \
+        if not errors else ""
+    if len(argv) == 5 and not errors:
+        sync_doc(argv[4], lines)
+    if errors:
+        print("\n".join(errors), file=sys.stderr)
+        return 1
+
+    # Only touch the header when it changes, so make does not rebuild
+    try:
+        with open(out_path, encoding="utf-8") as f:
+            if f.read() == header:
+                return 0
+    except FileNotFoundError:
+        pass
+    with open(out_path, "w", encoding="utf-8") as f:
+        f.write(header)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))